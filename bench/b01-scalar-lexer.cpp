@@ -0,0 +1,87 @@
+// Per-scalar cost of the single pass lexer (ParserBase::lex_scalar)
+// against the old try-each-type cascade.
+//
+// usage : b01-scalar-lexer [repeat-count]
+
+#include "timing.hpp"
+
+#include <parser_base.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace simpleConfig;
+using namespace std::literals::string_literals;
+
+namespace {
+
+    std::string make_input(int count) {
+        std::vector<std::string> samples = {
+            "true", "false", "12345", "-42", "0x1F",
+            "3.14159", "-2.5e-3", "1e10", "\"a string value\"", "99"
+        };
+
+        std::string out;
+        for (int i = 0; i < count; ++i) {
+            out += samples[i % samples.size()];
+            out += ' ';
+        }
+        return out;
+    }
+
+    // What match_scalar_value() used to do.
+    bool cascade(ParserBase &p) {
+        if (p.match_bool_value()) return true;
+        if (p.match_integer_value()) return true;
+        if (p.match_double_value()) return true;
+        if (p.match_string_value()) return true;
+        return false;
+    }
+
+    bool single(ParserBase &p) {
+        ParserBase::scalar_token tok;
+        std::string buf;
+        return p.lex_scalar(tok, buf);
+    }
+
+    template <typename F>
+    double run(const std::string &input, int scalars, int repeat, F f) {
+        std::optional<error_list> errs;
+        std::optional<ParserBase> p;
+
+        auto best = bench::best_of(repeat, [&]() {
+            p.reset();
+            errs.emplace();
+            p.emplace(input, "Bench"s, *errs);
+        }, [&]() {
+            int seen = 0;
+            while (f(*p)) ++seen;
+
+            if (seen != scalars) {
+                std::cerr << "only matched " << seen << " of " << scalars << "\n";
+                std::exit(1);
+            }
+        });
+
+        return bench::nanoseconds(best) / scalars;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 5;
+    const int scalars = 200000;
+
+    auto input = make_input(scalars);
+
+    double old_ns = run(input, scalars, repeat, cascade);
+    double new_ns = run(input, scalars, repeat, single);
+
+    std::cout << "cascade    : " << old_ns << " ns/scalar\n";
+    std::cout << "lex_scalar : " << new_ns << " ns/scalar\n";
+    std::cout << "speedup    : " << old_ns / new_ns << "x\n";
+
+    return 0;
+}
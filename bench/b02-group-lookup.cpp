@@ -0,0 +1,78 @@
+// Per-lookup cost of Setting::lkup(name) on groups of various sizes,
+// against a std::map<std::string, int> index like the one groups used
+// to have.
+//
+// usage : b02-group-lookup [repeat-count]
+
+#include "timing.hpp"
+
+#include <setting.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace simpleConfig;
+using namespace std::literals::string_literals;
+
+namespace {
+
+    std::vector<std::string> make_keys(int count) {
+        std::vector<std::string> keys;
+        for (int i = 0; i < count; ++i) {
+            keys.push_back("setting_key_"s + std::to_string((i * 7919) % 100003));
+        }
+        return keys;
+    }
+
+    template <typename F>
+    double run(const std::vector<std::string> &keys, int repeat, F f) {
+        const int rounds = 1000000 / int(keys.size()) + 1;
+
+        auto best = bench::best_of(repeat, [&]() {
+            long found = 0;
+            for (int n = 0; n < rounds; ++n) {
+                for (auto &k : keys) {
+                    found += f(std::string_view{k});
+                }
+            }
+
+            if (found != long(rounds) * long(keys.size())) {
+                std::cerr << "lookups failed\n";
+                std::exit(1);
+            }
+        });
+
+        return bench::nanoseconds(best) / (double(rounds) * double(keys.size()));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 5;
+
+    std::cout << "keys      std::map  GroupIndex\n";
+    for (int count : {4, 16, 64, 1000, 20000}) {
+        auto keys = make_keys(count);
+
+        std::map<std::string, int> old_index;
+        Setting group{ValType::GROUP};
+        for (auto &k : keys) {
+            old_index.emplace(k, int(old_index.size()));
+            group.add_child(k, 1);
+        }
+
+        // The old lkup() built a std::string for every lookup.
+        double old_ns = run(keys, repeat, [&](std::string_view k) {
+            return int(old_index.find(std::string(k)) != old_index.end());
+        });
+        double new_ns = run(keys, repeat, [&](std::string_view k) {
+            return int(group.lkup(k) != nullptr);
+        });
+
+        std::cout << count << "\t  " << old_ns << "\t    " << new_ns << " ns/lookup\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Per-lookup cost of Setting::at_path() against a CompiledPath made
+// once from the same string.
+//
+// usage : b03-compiled-path [repeat-count]
+
+#include "timing.hpp"
+
+#include <simpleConfig.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace simpleConfig;
+using namespace std::literals::string_literals;
+
+namespace {
+
+    // 20 sections of 10 keys, each holding a small array.
+    std::string make_config(std::vector<std::string> &paths) {
+        std::string out;
+        for (int s = 0; s < 20; ++s) {
+            out += "section_"s + std::to_string(s) + " : {\n";
+            for (int k = 0; k < 10; ++k) {
+                auto key = "value_"s + std::to_string(k);
+                out += "  " + key + " : [ 1, 2, 3 ],\n";
+                paths.push_back("section_"s + std::to_string(s) + "." + key + ".[2]");
+            }
+            out += "}\n";
+        }
+        return out;
+    }
+
+    template <typename F>
+    double run(size_t count, int repeat, F f) {
+        const int rounds = 5000;
+
+        auto best = bench::best_of(repeat, [&]() {
+            long total = 0;
+            for (int n = 0; n < rounds; ++n) {
+                for (size_t i = 0; i < count; ++i) {
+                    total += f(i);
+                }
+            }
+
+            if (total != long(rounds) * long(count) * 3) {
+                std::cerr << "lookups failed\n";
+                std::exit(1);
+            }
+        });
+
+        return bench::nanoseconds(best) / (double(rounds) * double(count));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 5;
+
+    std::vector<std::string> paths;
+    Config cfg;
+    if (not cfg.parse(make_config(paths))) {
+        cfg.stream_errors(std::cerr);
+        return 1;
+    }
+
+    std::vector<CompiledPath> compiled;
+    for (auto &p : paths) {
+        compiled.emplace_back(p);
+    }
+
+    double old_ns = run(paths.size(), repeat, [&](size_t i) {
+        return cfg.at_path(paths[i]).get<int>();
+    });
+    double new_ns = run(paths.size(), repeat, [&](size_t i) {
+        return cfg.get<int>(compiled[i]);
+    });
+
+    std::cout << "at_path      : " << old_ns << " ns/lookup\n";
+    std::cout << "CompiledPath : " << new_ns << " ns/lookup\n";
+    std::cout << "speedup      : " << old_ns / new_ns << "x\n";
+
+    return 0;
+}
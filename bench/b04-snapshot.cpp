@@ -0,0 +1,92 @@
+// Time to get a Config from a text file with parse_file() against
+// load_snapshot() of a snapshot of the same settings, against
+// parse_file() with a warm parse cache, and against a lazy parse_file()
+// that then reads one section.
+//
+// usage : b04-snapshot [repeat-count] [sections]
+
+#include "config_generator.hpp"
+#include "timing.hpp"
+
+#include <simpleConfig.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace simpleConfig;
+using namespace std::literals::string_literals;
+
+namespace {
+
+    // Best time in ms of `repeat` loads by f(), which returns false if
+    // the load failed.
+    template <typename F>
+    double run(int repeat, F f) {
+        return bench::milliseconds(bench::best_of(repeat, [&]() {
+            if (not f()) {
+                std::cerr << "load failed\n";
+                std::exit(1);
+            }
+        }));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 5;
+    int sections = argc > 2 ? std::atoi(argv[2]) : 20000;
+
+    auto text_file = "b04-snapshot.cfg"s;
+    auto snap_file = "b04-snapshot.snap"s;
+
+    {
+        std::ofstream strm{text_file, std::ios_base::binary};
+        strm << bench::service_sections(sections);
+    }
+    {
+        Config cfg;
+        if (not cfg.parse_file(text_file) or not cfg.save_snapshot(snap_file)) {
+            cfg.stream_errors(std::cerr);
+            return 1;
+        }
+    }
+
+    double text_ms = run(repeat, [&]() {
+        Config cfg;
+        return cfg.parse_file(text_file);
+    });
+    double snap_ms = run(repeat, [&]() {
+        Config cfg;
+        return cfg.load_snapshot(snap_file);
+    });
+
+    // The first run fills the cache.
+    auto cache_dir = "b04-cache"s;
+    std::filesystem::create_directory(cache_dir);
+    double cache_ms = run(repeat + 1, [&]() {
+        Config cfg;
+        cfg.set_cache_dir(cache_dir);
+        return cfg.parse_file(text_file);
+    });
+
+    double lazy_ms = run(repeat, [&]() {
+        Config cfg;
+        cfg.set_lazy(1);
+        return cfg.parse_file(text_file) and
+            cfg.at_path("section_7.port").get<int>() == 8007;
+    });
+
+    std::cout << "parse_file    : " << text_ms << " ms\n";
+    std::cout << "load_snapshot : " << snap_ms << " ms\n";
+    std::cout << "speedup       : " << text_ms / snap_ms << "x\n";
+    std::cout << "cached parse  : " << cache_ms << " ms\n";
+    std::cout << "lazy parse    : " << lazy_ms << " ms\n";
+
+    std::remove(text_file.c_str());
+    std::remove(snap_file.c_str());
+    std::filesystem::remove_all(cache_dir);
+    return 0;
+}
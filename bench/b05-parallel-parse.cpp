@@ -0,0 +1,56 @@
+// Time to parse a config with many top level groups on one thread and
+// with set_threads(n), for n up to the number of hardware threads.
+//
+// usage : b05-parallel-parse [repeat-count] [sections]
+
+#include "config_generator.hpp"
+#include "timing.hpp"
+
+#include <simpleConfig.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+
+using namespace simpleConfig;
+using namespace std::literals::string_literals;
+
+namespace {
+
+    double run(int repeat, const std::string &text, unsigned threads) {
+        // Each run parses into a new Config, made outside the clock.
+        std::optional<Config> cfg;
+        auto best = bench::best_of(repeat, [&]() {
+            cfg.emplace();
+            cfg->set_threads(threads);
+        }, [&]() {
+            if (not cfg->parse(text)) {
+                cfg->stream_errors(std::cerr);
+                std::exit(1);
+            }
+        });
+        return bench::milliseconds(best);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 5;
+    int sections = argc > 2 ? std::atoi(argv[2]) : 20000;
+
+    auto text = bench::service_sections(sections);
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+
+    double serial_ms = run(repeat, text, 1);
+    std::cout << "threads  1 : " << serial_ms << " ms\n";
+
+    for (unsigned n = 2; n <= std::max(hw, 2u); n *= 2) {
+        double ms = run(repeat, text, n);
+        std::cout << "threads " << (n < 10 ? " " : "") << n << " : " << ms
+            << " ms (" << serial_ms / ms << "x)\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Time to check a parsed config against a schema with the Validator
+// walking the SchemaNode tree, and with a ProgramValidator running the
+// compiled SchemaProgram. Three shapes : one wide group, a long array
+// of small groups, and a long array of strings checked against a large
+// enum.
+//
+// usage : b06-schema-program [repeat-count] [elements]
+
+#include "timing.hpp"
+
+#include <schema_parser.hpp>
+#include <config_parser.hpp>
+#include <schema_program.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace simpleConfig;
+using namespace std::literals::string_literals;
+
+namespace {
+
+    // width keys, every 7th required and every 5th with a default. The
+    // config leaves out every 3rd key that is not required.
+    void make_wide(int width, std::string &schema, std::string &config) {
+        for (int i = 0; i < width; ++i) {
+            auto n = std::to_string(i);
+            if (i % 7 == 0) {
+                schema += "key_" + n + "! : int\n";
+            } else if (i % 5 == 0) {
+                schema += "key_" + n + " : { _t : int _d : " + n + " }\n";
+            } else {
+                schema += "key_" + n + " : { _t : int _range : [0, 100000] }\n";
+            }
+            if (i % 7 == 0 or i % 3 != 0) {
+                config += "key_" + n + " : " + n + "\n";
+            }
+        }
+    }
+
+    void make_array(int elements, std::string &schema, std::string &config) {
+        schema += "hosts : { _t : array _at : group\n"
+            "  name! : string\n"
+            "  port : { _t : int _range : [1, 65535] }\n"
+            "  weight : { _t : float _d : 1.0 }\n"
+            "  mode : { _t : string _enum : [\"active\", \"standby\", \"drain\"] }\n"
+            "}\n";
+        config += "hosts : [\n";
+        for (int i = 0; i < elements; ++i) {
+            auto n = std::to_string(i);
+            config += "  { name : \"h" + n + "\", port : " + std::to_string(1 + i % 60000)
+                + ", mode : \"standby\" },\n";
+        }
+        config += "]\n";
+    }
+
+    void make_enum(int elements, std::string &schema, std::string &config) {
+        schema += "colours : { _t : array _at : string _enum : [";
+        for (int i = 0; i < 300; ++i) {
+            schema += "\"colour_" + std::to_string(i) + "\", ";
+        }
+        schema += "] }\n";
+        config += "colours : [\n";
+        for (int i = 0; i < elements; ++i) {
+            config += "  \"colour_" + std::to_string(i * 7 % 300) + "\",\n";
+        }
+        config += "]\n";
+    }
+
+    template <typename F>
+    double run(int repeat, const std::string &config, F check) {
+        std::optional<error_list> errors;
+        std::optional<Setting> tree;
+
+        // Defaults are added to the tree, so every run needs a fresh one.
+        auto best = bench::best_of(repeat, [&]() {
+            tree.reset();
+            errors.emplace();
+            tree.emplace(ValType::GROUP);
+            Parser parser{config, &*tree, *errors};
+            if (not parser.do_parse()) {
+                std::cerr << *errors;
+                std::exit(1);
+            }
+        }, [&]() {
+            if (not check(*tree, *errors)) {
+                std::cerr << *errors;
+                std::exit(1);
+            }
+        });
+
+        return bench::milliseconds(best);
+    }
+
+    void compare(const char *label, int repeat, const std::string &schema_text,
+            const std::string &config) {
+
+        error_list schema_errors;
+        SchemaNode root;
+        SchemaParser schema_parser{schema_text, &root, schema_errors};
+        if (not schema_parser.do_parse()) {
+            std::cerr << schema_errors;
+            std::exit(1);
+        }
+        SchemaProgram program{root};
+
+        double tree_ms = run(repeat, config, [&](Setting &tree, error_list &errors) {
+            Validator validator{errors};
+            return validator.validate(&tree, &root);
+        });
+        double program_ms = run(repeat, config, [&](Setting &tree, error_list &errors) {
+            ProgramValidator validator{program, errors};
+            return validator.validate(&tree);
+        });
+
+        std::cout << label << "\n";
+        std::cout << "  Validator        : " << tree_ms << " ms\n";
+        std::cout << "  ProgramValidator : " << program_ms << " ms ("
+            << tree_ms / program_ms << "x)\n";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 5;
+    int elements = argc > 2 ? std::atoi(argv[2]) : 50000;
+
+    {
+        std::string schema;
+        std::string config;
+        make_wide(1000, schema, config);
+        compare("wide group (1000 keys)", repeat * 20, schema, config);
+    }
+    {
+        std::string schema;
+        std::string config;
+        make_array(elements, schema, config);
+        compare(("array of " + std::to_string(elements) + " groups").c_str(),
+            repeat, schema, config);
+    }
+    {
+        std::string schema;
+        std::string config;
+        make_enum(elements, schema, config);
+        compare(("array of " + std::to_string(elements) + " strings, 300 member enum").c_str(),
+            repeat, schema, config);
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Time for parse() with a schema, checking the finished tree against
+// checking while parsing (set_single_pass()). Once for a config that
+// passes, and once for one with an unknown key near the start.
+//
+// usage : b07-single-pass [repeat-count] [sections]
+
+#include "timing.hpp"
+
+#include <simpleConfig.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace simpleConfig;
+using namespace std::literals::string_literals;
+
+namespace {
+
+    const std::string schema =
+        "* : { name! : string\n"
+        "      port : { _t : int _range : [1, 65535] }\n"
+        "      ratio : float\n"
+        "      enabled : { _t : bool _d : true }\n"
+        "      limits : { _t : array _at : int _len : [1, 8] }\n"
+        "      mode : { _t : string _enum : [\"active\", \"standby\"] }\n"
+        "      backends : { _t : array _at : group host! : string weight : { _t : float _d : 1.0 } }\n"
+        "}\n";
+
+    std::string make_config(int sections) {
+        std::string out;
+        for (int i = 0; i < sections; ++i) {
+            auto n = std::to_string(i);
+            out += "section_" + n + " : {\n";
+            out += "  name : \"service number " + n + "\",\n";
+            out += "  port : " + std::to_string(8000 + i % 1000) + ",\n";
+            out += "  ratio : 0." + n + ",\n";
+            out += "  limits : [ 10, 20, 30, 40 ],\n";
+            out += "  mode : \"standby\",\n";
+            out += "  backends : [ { host : \"h" + n + "a\", weight : 1.5 },"
+                " { host : \"h" + n + "b\" } ]\n";
+            out += "}\n";
+        }
+        return out;
+    }
+
+    double run(int repeat, const std::string &text, bool single_pass, bool expect_ok) {
+        std::optional<Config> cfg;
+
+        auto best = bench::best_of(repeat, [&]() {
+            cfg.emplace();
+            cfg->set_single_pass(single_pass);
+            if (not cfg->set_schema(schema)) {
+                cfg->stream_errors(std::cerr);
+                std::exit(1);
+            }
+        }, [&]() {
+            if (cfg->parse(text) != expect_ok) {
+                cfg->stream_errors(std::cerr);
+                std::exit(1);
+            }
+        });
+
+        return bench::milliseconds(best);
+    }
+
+    void compare(const char *label, int repeat, const std::string &text, bool expect_ok) {
+        double after_ms = run(repeat, text, false, expect_ok);
+        double fused_ms = run(repeat, text, true, expect_ok);
+        std::cout << label << "\n";
+        std::cout << "  parse then check : " << after_ms << " ms\n";
+        std::cout << "  single pass      : " << fused_ms << " ms ("
+            << after_ms / fused_ms << "x)\n";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 5;
+    int sections = argc > 2 ? std::atoi(argv[2]) : 20000;
+
+    auto text = make_config(sections);
+    compare("valid config", repeat, text, true);
+
+    auto bad = "section_x : { name : \"x\", colour : \"red\" }\n" + text;
+    compare("unknown key in the first section", repeat, bad, false);
+
+    return 0;
+}
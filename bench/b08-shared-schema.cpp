@@ -0,0 +1,86 @@
+// Time to parse many small configs against one schema, when every Config
+// parses the schema text with set_schema(text) and when they all share
+// one Schema.
+//
+// usage : b08-shared-schema [repeat-count] [configs]
+
+#include "timing.hpp"
+
+#include <simpleConfig.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace simpleConfig;
+using namespace std::literals::string_literals;
+
+namespace {
+
+    std::string make_schema() {
+        std::string out;
+        for (int i = 0; i < 60; ++i) {
+            auto n = std::to_string(i);
+            out += "section_" + n + " : { name : string, port : { _t : int _range : [1, 65535] _d : 80 },"
+                " mode : { _t : string _enum : [\"active\", \"standby\", \"drain\"] _d : \"active\" } }\n";
+        }
+        return out;
+    }
+
+    std::string make_config(int tenant) {
+        auto n = std::to_string(tenant);
+        return "section_1 : { name : \"tenant " + n + "\", port : 8080 }\n"
+            "section_7 : { name : \"tenant " + n + "\", mode : \"drain\" }\n";
+    }
+
+    // Best time in ms of `repeat` calls of f(), which returns false if a
+    // parse failed.
+    template <typename F>
+    double run(int repeat, F f) {
+        return bench::milliseconds(bench::best_of(repeat, [&]() {
+            if (not f()) {
+                std::cerr << "parse failed\n";
+                std::exit(1);
+            }
+        }));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 5;
+    int count = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+    auto schema_text = make_schema();
+    std::vector<std::string> configs;
+    for (int i = 0; i < count; ++i) {
+        configs.push_back(make_config(i));
+    }
+
+    double own_ms = run(repeat, [&]() {
+        for (auto &text : configs) {
+            Config cfg;
+            if (not cfg.set_schema(schema_text) or not cfg.parse(text)) return false;
+        }
+        return true;
+    });
+
+    double shared_ms = run(repeat, [&]() {
+        error_list errors;
+        auto schema = Schema::parse(schema_text, errors);
+        if (not schema) return false;
+        for (auto &text : configs) {
+            Config cfg;
+            cfg.set_schema(schema);
+            if (not cfg.parse(text)) return false;
+        }
+        return true;
+    });
+
+    std::cout << count << " configs\n";
+    std::cout << "  set_schema(text) each : " << own_ms << " ms\n";
+    std::cout << "  one shared Schema     : " << shared_ms << " ms ("
+        << own_ms / shared_ms << "x)\n";
+
+    return 0;
+}
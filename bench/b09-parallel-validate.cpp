@@ -0,0 +1,97 @@
+// Time to check a routing table of many small groups against a schema
+// with ProgramValidator and with ParallelValidator on n threads, for n up
+// to the number of hardware threads.
+//
+// usage : b09-parallel-validate [repeat-count] [routes]
+
+#include "timing.hpp"
+
+#include <schema_parser.hpp>
+#include <config_parser.hpp>
+#include <parallel_validator.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+
+using namespace simpleConfig;
+using namespace std::literals::string_literals;
+
+namespace {
+
+    const std::string schema_text =
+        "routes : { _t : array _at : group\n"
+        "  dest! : string\n"
+        "  prefix : { _t : int _range : [0, 32] }\n"
+        "  metric : { _t : int _d : 1 }\n"
+        "  proto : { _t : string _enum : [\"static\", \"ospf\", \"bgp\"] }\n"
+        "  hops : { _t : array _at : string _len : [1, 4] }\n"
+        "}\n";
+
+    std::string make_config(int routes) {
+        std::string out = "routes : [\n";
+        for (int i = 0; i < routes; ++i) {
+            auto n = std::to_string(i);
+            out += "  { dest : \"10." + std::to_string(i % 256) + ".0.0\", prefix : "
+                + std::to_string(8 + i % 24) + ", proto : \"ospf\", hops : [\"r" + n + "\"] },\n";
+        }
+        return out + "]\n";
+    }
+
+    double run(int repeat, const SchemaProgram &program, const std::string &config, unsigned threads) {
+        std::optional<error_list> errors;
+        std::optional<Setting> tree;
+
+        // Defaults are added to the tree, so every run needs a fresh one.
+        auto best = bench::best_of(repeat, [&]() {
+            tree.reset();
+            errors.emplace();
+            tree.emplace(ValType::GROUP);
+            Parser parser{config, &*tree, *errors};
+            if (not parser.do_parse()) {
+                std::cerr << *errors;
+                std::exit(1);
+            }
+        }, [&]() {
+            ParallelValidator validator{program, *errors, threads};
+            if (not validator.validate(&*tree)) {
+                std::cerr << *errors;
+                std::exit(1);
+            }
+        });
+
+        return bench::milliseconds(best);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 5;
+    int routes = argc > 2 ? std::atoi(argv[2]) : 100000;
+
+    error_list errors;
+    SchemaNode root;
+    SchemaParser schema_parser{schema_text, &root, errors};
+    if (not schema_parser.do_parse()) {
+        std::cerr << errors;
+        return 1;
+    }
+    SchemaProgram program{root};
+
+    auto config = make_config(routes);
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+
+    // One thread is the plain ProgramValidator.
+    double serial_ms = run(repeat, program, config, 1);
+    std::cout << "threads  1 : " << serial_ms << " ms\n";
+
+    for (unsigned n = 2; n <= std::max(hw, 2u); n *= 2) {
+        double ms = run(repeat, program, config, n);
+        std::cout << "threads " << (n < 10 ? " " : "") << n << " : " << ms
+            << " ms (" << serial_ms / ms << "x)\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+// The main operations on generated configs of each shape (see
+// config_generator.hpp) : Parser::do_parse(), Validator::validate(),
+// Setting::stream_setting() and Setting::lkup_path(). Reports the
+// throughput and how many allocations each one made.
+//
+// usage : b10-suite [repeat-count] [megabytes] [shape ...]
+//
+// With no shapes given, all of them are run.
+
+#include "config_generator.hpp"
+#include "timing.hpp"
+
+#include <schema_parser.hpp>
+#include <config_parser.hpp>
+#include <validator.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace simpleConfig;
+using namespace std::literals::string_literals;
+
+//############## allocation counting ####
+
+namespace {
+
+    std::atomic<size_t> alloc_count{0};
+    std::atomic<size_t> alloc_bytes{0};
+
+    void *counted_alloc(std::size_t n, std::size_t align) {
+        alloc_count.fetch_add(1, std::memory_order_relaxed);
+        alloc_bytes.fetch_add(n, std::memory_order_relaxed);
+        if (n == 0) n = 1;
+        void *p = (align <= alignof(std::max_align_t))
+            ? std::malloc(n)
+            : std::aligned_alloc(align, (n + align - 1) / align * align);
+        if (not p) throw std::bad_alloc();
+        return p;
+    }
+}
+
+void *operator new(std::size_t n) { return counted_alloc(n, 0); }
+void *operator new[](std::size_t n) { return counted_alloc(n, 0); }
+void *operator new(std::size_t n, std::align_val_t a) { return counted_alloc(n, size_t(a)); }
+void *operator new[](std::size_t n, std::align_val_t a) { return counted_alloc(n, size_t(a)); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+//############## measuring ####
+
+namespace {
+
+    // The best time of the runs, and the allocations of one run.
+    struct measure {
+        double ms = 0;
+        size_t allocs = 0;
+        size_t bytes = 0;
+    };
+
+    // Times f() alone; setup() runs before each call, outside the clock.
+    template <typename S, typename F>
+    measure run(int repeat, S setup, F f) {
+        measure m;
+        auto best = bench::best_of(repeat, setup, [&]() {
+            auto count = alloc_count.load();
+            auto bytes = alloc_bytes.load();
+            f();
+            m.allocs = alloc_count.load() - count;
+            m.bytes = alloc_bytes.load() - bytes;
+        });
+        m.ms = bench::milliseconds(best);
+        return m;
+    }
+
+    size_t count_nodes(const Setting &s) {
+        size_t n = 1;
+        if (s.is_composite()) {
+            for (auto &child : s) {
+                n += count_nodes(child);
+            }
+        }
+        return n;
+    }
+
+    void report(const char *label, const measure &m, double megabytes, double items,
+            const char *item_name) {
+        double seconds = m.ms / 1000.0;
+        char rate[32] = "";
+        if (megabytes > 0) {
+            std::snprintf(rate, sizeof(rate), "%9.1f MB/s", megabytes / seconds);
+        }
+        char line[200];
+        std::snprintf(line, sizeof(line),
+            "  %-9s : %9.3f ms %14s %8.2f M %s/s   allocs %9zu (%.1f MB)\n",
+            label, m.ms, rate, items / seconds / 1e6,
+            item_name, m.allocs, double(m.bytes) / 1e6);
+        std::cout << line;
+    }
+
+    void fail(const std::string &what, const error_list &errors) {
+        std::cerr << what << " failed\n" << errors;
+        std::exit(1);
+    }
+
+    void run_shape(bench::Shape shape, int repeat, size_t bytes) {
+        auto g = bench::generate(shape, bytes);
+        double megabytes = double(g.config.size()) / 1e6;
+
+        error_list schema_errors;
+        SchemaNode schema;
+        SchemaParser schema_parser{g.schema, &schema, schema_errors};
+        if (not schema_parser.do_parse()) fail("schema parse", schema_errors);
+
+        std::unique_ptr<Setting> tree;
+        error_list errors;
+        auto parse_tree = [&]() {
+            tree = std::make_unique<Setting>(ValType::GROUP);
+            errors = error_list{};
+            Parser parser{g.config, tree.get(), errors};
+            if (not parser.do_parse()) fail("parse", errors);
+        };
+
+        auto parse = run(repeat, [&]() { tree.reset(); }, parse_tree);
+        auto nodes = double(count_nodes(*tree));
+
+        // Defaults are added to the tree, so each run checks a fresh one.
+        auto validate = run(repeat, parse_tree, [&]() {
+            Validator validator{errors};
+            if (not validator.validate(tree.get(), &schema)) fail("validate", errors);
+        });
+
+        std::ostringstream out;
+        auto stream = run(repeat, [&]() { out.str(""s); }, [&]() {
+            tree->stream_setting(out);
+        });
+        double out_megabytes = double(out.str().size()) / 1e6;
+
+        const int rounds = 100;
+        size_t found = 0;
+        auto lookups = run(repeat, [&]() { found = 0; }, [&]() {
+            for (int n = 0; n < rounds; ++n) {
+                for (auto &p : g.paths) {
+                    found += (tree->lkup_path(p) != nullptr);
+                }
+            }
+        });
+        if (found != rounds * g.paths.size()) {
+            std::cerr << "lookups failed\n";
+            std::exit(1);
+        }
+
+        std::cout << bench::shape_name(shape) << " : " << megabytes << " MB, "
+            << size_t(nodes) << " nodes, " << g.paths.size() << " paths\n";
+        report("parse", parse, megabytes, nodes, "nodes");
+        report("validate", validate, megabytes, nodes, "nodes");
+        report("stream", stream, out_megabytes, nodes, "nodes");
+        report("lookups", lookups, 0, double(rounds) * double(g.paths.size()), "paths");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repeat = argc > 1 ? std::atoi(argv[1]) : 5;
+    double megabytes = argc > 2 ? std::atof(argv[2]) : 4.0;
+
+    std::vector<bench::Shape> shapes;
+    for (int a = 3; a < argc; ++a) {
+        bool known = false;
+        for (auto s : bench::all_shapes) {
+            if (std::strcmp(argv[a], bench::shape_name(s)) == 0) {
+                shapes.push_back(s);
+                known = true;
+            }
+        }
+        if (not known) {
+            std::cerr << "unknown shape " << argv[a] << "\n";
+            return 1;
+        }
+    }
+    if (shapes.empty()) {
+        shapes.assign(std::begin(bench::all_shapes), std::end(bench::all_shapes));
+    }
+
+    for (auto s : shapes) {
+        run_shape(s, repeat, size_t(megabytes * 1e6));
+    }
+
+    return 0;
+}
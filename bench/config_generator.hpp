@@ -0,0 +1,245 @@
+#pragma once
+
+// Makes synthetic configs for the benchmarks : configs of a chosen shape
+// and size, along with a schema they pass and some paths that exist in
+// them, and configs of many service sections.
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace simpleConfig::bench {
+
+    enum class Shape {
+        WIDE,           // groups of 1000 keys of mixed types
+        DEEP,           // groups nested 32 deep
+        SCALAR_ARRAY,   // one long array of ints and one of floats
+        GROUP_ARRAY,    // one long array of small groups
+        STRINGS,        // long strings with escapes
+        COMMENTS        // more comment than setting
+    };
+
+    inline constexpr Shape all_shapes[] = {
+        Shape::WIDE, Shape::DEEP, Shape::SCALAR_ARRAY,
+        Shape::GROUP_ARRAY, Shape::STRINGS, Shape::COMMENTS
+    };
+
+    inline const char *shape_name(Shape s) {
+        switch (s) {
+            case Shape::WIDE : return "wide";
+            case Shape::DEEP : return "deep";
+            case Shape::SCALAR_ARRAY : return "scalar-array";
+            case Shape::GROUP_ARRAY : return "group-array";
+            case Shape::STRINGS : return "strings";
+            case Shape::COMMENTS : return "comments";
+        }
+        return "?";
+    }
+
+    // `sections` top level groups like the settings of a service, each
+    // after a comment : a few scalars, an array of ints and a list of two
+    // groups.
+    inline std::string service_sections(int sections) {
+        std::string out;
+        for (int i = 0; i < sections; ++i) {
+            auto n = std::to_string(i);
+            out += "# section " + n + "\n";
+            out += "section_" + n + " : {\n";
+            out += "  name : \"service number " + n + "\",\n";
+            out += "  port : " + std::to_string(8000 + i % 1000) + ",\n";
+            out += "  ratio : 0." + n + ",\n";
+            out += "  enabled : true,\n";
+            out += "  limits : [ 10, 20, 30, 40 ],\n";
+            out += "  backends : ( { host : \"h" + n + "a\", weight : 1.5 },"
+                " { host : \"h" + n + "b\", weight : 2.5 } )\n";
+            out += "}\n";
+        }
+        return out;
+    }
+
+    struct generated {
+        std::string config;
+        std::string schema;
+        std::vector<std::string> paths;
+    };
+
+    // A config of about `bytes` bytes (it stops at the first whole unit
+    // past that). The same shape, size and seed always give the same text.
+    inline generated generate(Shape shape, size_t bytes, unsigned seed = 1) {
+        generated g;
+        std::mt19937 rng{seed};
+        auto pick = [&](int n) { return int(rng() % unsigned(n)); };
+
+        // Keep about this many paths, spread over the config.
+        const size_t path_limit = 1000;
+        size_t path_every = 1;
+        auto add_path = [&](size_t n, std::string path) {
+            if (n % path_every == 0 and g.paths.size() < path_limit) {
+                g.paths.push_back(std::move(path));
+            }
+        };
+
+        switch (shape) {
+            case Shape::WIDE : {
+                const int width = 1000;
+                g.schema = "* : {\n";
+                for (int k = 0; k < width; ++k) {
+                    auto key = "key_" + std::to_string(k);
+                    switch (k % 4) {
+                        case 0 : g.schema += "  " + key + "! : int\n"; break;
+                        case 1 : g.schema += "  " + key + " : { _t : float _range : [-1000.0, 1000.0] }\n"; break;
+                        case 2 : g.schema += "  " + key + " : string\n"; break;
+                        default : g.schema += "  " + key + " : { _t : bool _d : false }\n"; break;
+                    }
+                }
+                g.schema += "}\n";
+
+                path_every = (bytes / 20000) + 1;
+                for (size_t s = 0; g.config.size() < bytes; ++s) {
+                    auto group = "group_" + std::to_string(s);
+                    g.config += group + " : {\n";
+                    for (int k = 0; k < width; ++k) {
+                        auto key = "key_" + std::to_string(k);
+                        switch (k % 4) {
+                            case 0 : g.config += "  " + key + " : " + std::to_string(pick(100000)) + "\n"; break;
+                            case 1 : g.config += "  " + key + " : " + std::to_string(pick(1999) - 999) + ".25\n"; break;
+                            case 2 : g.config += "  " + key + " : \"v" + std::to_string(pick(1000)) + "\"\n"; break;
+                            default :
+                                if (pick(2)) g.config += "  " + key + " : true\n";
+                                break;
+                        }
+                        add_path(s * width + size_t(k), group + "." + key);
+                    }
+                    g.config += "}\n";
+                }
+                break;
+            }
+
+            case Shape::DEEP : {
+                const int depth = 32;
+                std::string inner = "v : int";
+                for (int d = depth - 1; d > 0; --d) {
+                    inner = "v : int level_" + std::to_string(d) + " : { " + inner + " }";
+                }
+                g.schema = "* : { " + inner + " }\n";
+
+                std::string deepest = "";
+                for (int d = 1; d < depth; ++d) {
+                    deepest += ".level_" + std::to_string(d);
+                }
+
+                path_every = (bytes / 1000000) + 1;
+                for (size_t s = 0; g.config.size() < bytes; ++s) {
+                    auto top = "nest_" + std::to_string(s);
+                    g.config += top + " : {";
+                    for (int d = 1; d < depth; ++d) {
+                        g.config += " v : " + std::to_string(pick(1000)) + "\n";
+                        g.config += std::string(size_t(d), ' ') + "level_" + std::to_string(d) + " : {";
+                    }
+                    g.config += " v : 0";
+                    g.config += std::string(size_t(depth - 1), '}') + " }\n";
+                    add_path(s, top + deepest + ".v");
+                }
+                break;
+            }
+
+            case Shape::SCALAR_ARRAY : {
+                g.schema = "ints : { _t : array _at : int }\n"
+                    "floats : { _t : array _at : float }\n";
+
+                size_t half = bytes / 2;
+                g.config = "ints : [";
+                size_t n = 0;
+                path_every = (bytes / 8000) + 1;
+                for (; g.config.size() < half; ++n) {
+                    g.config += (n % 16 == 0 ? "\n  " : " ") + std::to_string(pick(2000000) - 1000000) + ",";
+                    add_path(n, "ints.[" + std::to_string(n) + "]");
+                }
+                g.config += " 0 ]\nfloats : [";
+                for (size_t f = 0; g.config.size() < bytes; ++f) {
+                    g.config += (f % 8 == 0 ? "\n  " : " ") + std::to_string(pick(100000)) + ".5e-3,";
+                    add_path(f, "floats.[" + std::to_string(f) + "]");
+                }
+                g.config += " 0.0 ]\n";
+                break;
+            }
+
+            case Shape::GROUP_ARRAY : {
+                g.schema = "hosts : { _t : array _at : group\n"
+                    "  name! : string\n"
+                    "  port : { _t : int _range : [1, 65535] }\n"
+                    "  weight : { _t : float _d : 1.0 }\n"
+                    "  tags : { _t : array _at : string _len : [0, 4] }\n"
+                    "}\n";
+
+                path_every = (bytes / 80000) + 1;
+                g.config = "hosts : [\n";
+                for (size_t n = 0; g.config.size() < bytes; ++n) {
+                    auto num = std::to_string(n);
+                    g.config += "  { name : \"host-" + num + ".example.com\", port : "
+                        + std::to_string(1 + pick(65535));
+                    if (pick(2)) {
+                        g.config += ", weight : 0." + std::to_string(pick(100));
+                    }
+                    g.config += ", tags : [ \"a\", \"b" + std::to_string(pick(10)) + "\" ] },\n";
+                    add_path(n, "hosts.[" + num + "].port");
+                }
+                g.config += "]\n";
+                break;
+            }
+
+            case Shape::STRINGS : {
+                g.schema = "* : string\n";
+
+                static const char *words[] = {
+                    "alpha", "bravo", "charlie", "delta", "echo", "foxtrot",
+                    "\\\"quoted\\\"", "tab\\there", "line\\nbreak", "back\\\\slash", "\\x41"
+                };
+                const int word_count = int(sizeof(words) / sizeof(words[0]));
+
+                path_every = (bytes / 200000) + 1;
+                for (size_t n = 0; g.config.size() < bytes; ++n) {
+                    auto key = "text_" + std::to_string(n);
+                    g.config += key + " : \"";
+                    int length = 8 + pick(40);
+                    for (int w = 0; w < length; ++w) {
+                        g.config += words[pick(word_count)];
+                        g.config += ' ';
+                    }
+                    g.config += "\"\n";
+                    add_path(n, key);
+                }
+                break;
+            }
+
+            case Shape::COMMENTS : {
+                g.schema = "* : int\n";
+
+                path_every = (bytes / 100000) + 1;
+                for (size_t n = 0; g.config.size() < bytes; ++n) {
+                    auto key = "value_" + std::to_string(n);
+                    switch (n % 3) {
+                        case 0 :
+                            g.config += "# The next setting is " + key + ", which holds a number\n"
+                                "# picked more or less at random for the benchmark.\n";
+                            break;
+                        case 1 :
+                            g.config += "// " + key + " : the same again, with the other line comment\n";
+                            break;
+                        default :
+                            g.config += "/* A block comment that runs over\n"
+                                "   several lines, { with brackets } and \"quotes\",\n"
+                                "   before " + key + ". */\n";
+                            break;
+                    }
+                    g.config += key + " : " + std::to_string(pick(1000000)) + " // trailing\n";
+                    add_path(n, key);
+                }
+                break;
+            }
+        }
+
+        return g;
+    }
+
+}
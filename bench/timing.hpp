@@ -0,0 +1,40 @@
+#pragma once
+
+// Timing for the benchmarks, each of which reports the best of several
+// runs.
+
+#include <chrono>
+
+namespace simpleConfig::bench {
+
+    using clock = std::chrono::steady_clock;
+
+    // The best time of `repeat` calls of f(). setup() runs before each
+    // call, outside the clock.
+    template <typename S, typename F>
+    clock::duration best_of(int repeat, S &&setup, F &&f) {
+        auto best = clock::duration::max();
+        for (int r = 0; r < repeat; ++r) {
+            setup();
+            auto start = clock::now();
+            f();
+            auto elapsed = clock::now() - start;
+            if (elapsed < best) best = elapsed;
+        }
+        return best;
+    }
+
+    template <typename F>
+    clock::duration best_of(int repeat, F &&f) {
+        return best_of(repeat, []() {}, f);
+    }
+
+    inline double milliseconds(clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    inline double nanoseconds(clock::duration d) {
+        return std::chrono::duration<double, std::nano>(d).count();
+    }
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "setting.hpp"
+#include "group_index.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cctype>
+#include <stdexcept>
+
+namespace simpleConfig {
+
+    // A path that has been taken apart once so it can be looked up many
+    // times. Keys are hashed up front and `[n]` pieces are already
+    // numbers, so resolving the path allocates nothing and does no
+    // parsing.
+    //
+    //  CompiledPath port{"server.listen.[0].port"};
+    //  int p = port.get<int>(cfg.get_settings());
+    //
+    class CompiledPath {
+
+        struct step {
+            bool is_index;
+            int index;
+            uint32_t offset;    // key text in text_
+            uint32_t len;
+            uint64_t hash;
+        };
+
+        // The key text of all the steps, back to back.
+        std::string text_;
+        std::vector<step> steps_;
+
+        std::string_view key_of(const step &s) const {
+            return {text_.data() + s.offset, s.len};
+        }
+
+        void add_key(std::string_view key) {
+            steps_.push_back(step{false, 0, uint32_t(text_.size()),
+                uint32_t(key.size()), GroupIndex::hash(key)});
+            text_.append(key);
+        }
+
+        void add_index(int index) {
+            steps_.push_back(step{true, index, 0, 0, 0});
+        }
+
+        // The whole of `s` as a decimal integer.
+        static bool to_int(std::string_view s, int &out) {
+            std::string tmp{s};
+            if (tmp.empty()) return false;
+            char *end;
+            long v = std::strtol(tmp.c_str(), &end, 10);
+            if (end != tmp.c_str() + tmp.size()) return false;
+            out = int(v);
+            return true;
+        }
+
+    public :
+
+        // Same syntax as Setting::at_path() : keys and `[n]` indices
+        // separated by dots. Throws std::runtime_error if it is malformed.
+        explicit CompiledPath(std::string_view path) {
+            while (true) {
+                auto point_index = path.find('.');
+                auto piece = path.substr(0, point_index);
+
+                if (piece.empty()) {
+                    throw std::runtime_error("Empty element in path");
+                }
+
+                if (piece.front() == '[') {
+                    int index;
+                    if (piece.size() < 3 or piece.back() != ']'
+                            or not to_int(piece.substr(1, piece.size() - 2), index)) {
+                        throw std::runtime_error("Bad index in path : "s + std::string(piece));
+                    }
+                    add_index(index);
+                } else {
+                    add_key(piece);
+                }
+
+                if (point_index == std::string_view::npos) break;
+                path.remove_prefix(point_index + 1);
+            }
+        }
+
+        // Same rules as Setting::at_vpath() : an element starting with a
+        // digit or sign is an index.
+        explicit CompiledPath(const std::vector<std::string> &path) {
+            for (auto const &e : path) {
+                auto first_char = e.empty() ? '\0' : e.front();
+
+                if (std::isdigit(first_char) or first_char == '-' or first_char == '+' ) {
+                    int index;
+                    if (not to_int(e, index)) {
+                        throw std::runtime_error("at_path element is an invalid decimal integer");
+                    }
+                    add_index(index);
+                } else {
+                    add_key(e);
+                }
+            }
+        }
+
+        size_t size() const { return steps_.size(); }
+
+        // nullptr if any step is missing.
+        Setting *lkup(Setting &root) const {
+            Setting *current = &root;
+            for (auto const &s : steps_) {
+                if (s.is_index) {
+                    current = current->lkup(s.index);
+                } else {
+                    current = current->lkup(key_of(s), s.hash);
+                }
+                if (not current) return nullptr;
+            }
+            return current;
+        }
+
+        // Throws the same errors as Setting::at() if any step is missing.
+        Setting &at(Setting &root) const {
+            Setting *current = &root;
+            for (auto const &s : steps_) {
+                if (s.is_index) {
+                    current = &current->at(s.index);
+                } else {
+                    auto *next = current->lkup(key_of(s), s.hash);
+                    // at() knows which error to give.
+                    current = next ? next : &current->at(key_of(s));
+                }
+            }
+            return *current;
+        }
+
+        template<typename T> T get(Setting &root) const {
+            return at(root).get<T>();
+        }
+
+        // `fallback` if the path doesn't resolve.
+        template<typename T> T get(Setting &root, T fallback) const {
+            auto *s = lkup(root);
+            return s ? s->get<T>() : fallback;
+        }
+    };
+
+}
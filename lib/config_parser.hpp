@@ -1,6 +1,8 @@
 #pragma once
 
 #include "parser_base.hpp"
+#include "parse_handler.hpp"
+#include "setting_builder.hpp"
 
 #include "value_type.hpp"
 #include "setting.hpp"
@@ -15,15 +17,15 @@ namespace simpleConfig {
     using VT = ValType;
 
 
-    struct Parser : public ParserBase {
+    // Parses a config and hands the events to a ParseHandler.
+    struct EventParser : public ParserBase {
 
-        Setting *setting;
+        EventParser(std::string_view _src, ParseHandler *h, error_list &errlist) :
+            ParserBase(_src, "Config"s, errlist)
+        {
+            handler = h;
+        }
 
-        Parser(std::string_view _src, Setting *s, error_list &errlist) :
-            ParserBase(_src, "Config"s, errlist),
-            setting{s}
-        {}
-        
 
         //##############   do_parse  #####################
         
@@ -31,10 +33,21 @@ namespace simpleConfig {
             ENTER;
 
             error_count = 0;
+            stopped = false;
+            skip_depth = 0;
+            if (handler) handler->loc = &current_loc;
+            SC_STAT(int start = current_loc.offset;)
+            trace_span span{trace, "parse", "parse"};
 
             skip();
 
-            parse_group(setting);
+            parse_group();
+
+            SC_STAT(if (stats) stats->config_bytes += size_t(current_loc.offset - start);)
+
+            if (stopped) {
+                RETURN_B(not has_errors());
+            }
 
             if (! eoi()) {
                 record_error("Not at end of input!");
@@ -44,7 +57,45 @@ namespace simpleConfig {
             RETURN_B(not has_errors());
         }
 
+        // Parse the body of a group that an earlier parse deferred, as if
+        // it were a whole config. `body` is as given to deferred_group(),
+        // and must point into the text this parser was made with.
+        bool do_parse_body(const parse_loc &body) {
+            current_loc = body;
+            return do_parse();
+        }
+
+    };
+
+
+    // Parses a config into a Setting tree.
+    struct Parser : public EventParser {
+
+        SettingBuilder builder;
+
+        Setting *setting;
+
+        Parser(std::string_view _src, Setting *s, error_list &errlist) :
+            EventParser(_src, nullptr, errlist),
+            builder{s},
+            setting{s}
+        {
+            handler = &builder;
+        }
+
+        bool do_parse() {
+            builder.borrow_strings = borrow_strings;
+            builder.stats = stats;
+            return EventParser::do_parse();
+        }
+
+        bool do_parse_body(const parse_loc &body) {
+            builder.borrow_strings = borrow_strings;
+            builder.stats = stats;
+            return EventParser::do_parse_body(body);
+        }
+
     };
 
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "setting.hpp"
+#include "group_index.hpp"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+namespace simpleConfig {
+
+    // The values of an `_enum` list, kept so that membership can be
+    // tested without walking the list.
+    //
+    // Integers and floats are kept sorted and found by binary search.
+    // String text lives in one buffer; up to small_limit strings are
+    // binary searched, past that an open addressing hash table is used.
+    // Each value is kept in every list its type allows, so an integer in
+    // the list also matches the equal float, as Setting::get<double>()
+    // would have it.
+    class EnumSet {
+
+    public :
+        static constexpr size_t small_limit = GroupIndex::small_limit;
+
+    private :
+
+        struct key_ref {
+            uint32_t offset;
+            uint32_t len;
+            uint32_t hash;
+        };
+
+        std::vector<int> ints_;
+        std::vector<double> floats_;
+
+        std::string chars_;
+        std::vector<key_ref> strings_;  // sorted by text
+
+        // 0 is empty, otherwise the index in strings_ + 1. Only used once
+        // there are more than small_limit strings.
+        std::vector<uint32_t> table_;
+
+        std::string_view text_of(const key_ref &k) const {
+            return {chars_.data() + k.offset, k.len};
+        }
+
+    public :
+        EnumSet() = default;
+
+        explicit EnumSet(const Setting &values) {
+            assign(values);
+        }
+
+        void assign(const Setting &values) {
+            clear();
+
+            for (auto &v : values) {
+                if (v.is_integer()) {
+                    ints_.push_back(v.get<int>());
+                }
+                if (v.is_numeric()) {
+                    floats_.push_back(v.get<double>());
+                }
+                if (v.is_string()) {
+                    auto text = v.get<std::string_view>();
+                    strings_.push_back(key_ref{uint32_t(chars_.size()), uint32_t(text.size()),
+                        uint32_t(GroupIndex::hash(text))});
+                    chars_.append(text);
+                }
+            }
+
+            std::sort(ints_.begin(), ints_.end());
+            std::sort(floats_.begin(), floats_.end());
+            std::sort(strings_.begin(), strings_.end(),
+                [this](const key_ref &a, const key_ref &b) { return text_of(a) < text_of(b); });
+
+            if (strings_.size() > small_limit) {
+                size_t size = 16;
+                while (size < strings_.size() * 2) {
+                    size *= 2;
+                }
+                table_.assign(size, 0);
+                size_t mask = size - 1;
+                for (uint32_t n = 0; n < strings_.size(); ++n) {
+                    size_t at = strings_[n].hash & mask;
+                    while (table_[at] != 0) {
+                        at = (at + 1) & mask;
+                    }
+                    table_[at] = n + 1;
+                }
+            }
+        }
+
+        void clear() {
+            ints_.clear();
+            floats_.clear();
+            chars_.clear();
+            strings_.clear();
+            table_.clear();
+        }
+
+        bool contains(int v) const {
+            return std::binary_search(ints_.begin(), ints_.end(), v);
+        }
+
+        bool contains(double v) const {
+            return std::binary_search(floats_.begin(), floats_.end(), v);
+        }
+
+        bool contains(std::string_view v) const {
+            if (table_.empty()) {
+                auto iter = std::lower_bound(strings_.begin(), strings_.end(), v,
+                    [this](const key_ref &k, std::string_view s) { return text_of(k) < s; });
+                return (iter != strings_.end() and text_of(*iter) == v);
+            }
+
+            auto h = uint32_t(GroupIndex::hash(v));
+            size_t mask = table_.size() - 1;
+            for (size_t at = h & mask; table_[at] != 0; at = (at + 1) & mask) {
+                auto &k = strings_[table_[at] - 1];
+                if (k.hash == h and k.len == v.size()
+                        and std::memcmp(chars_.data() + k.offset, v.data(), k.len) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+}
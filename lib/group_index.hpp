@@ -0,0 +1,201 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace simpleConfig {
+
+    // Maps the keys of a group to the position of their child.
+    //
+    // Keys are numbered in the order they were added, which is also the
+    // order of the children of the group. All the key text lives in one
+    // buffer.
+    //
+    // Small groups are looked up by binary search over a key-sorted list of
+    // positions. Once a group grows past small_limit, an open addressing
+    // hash table is built and used instead. The sorted list is then only
+    // brought up to date when sorted() asks for it.
+    //
+    // sorted() may reorder that list on a large group, so it is not safe
+    // to call from several threads at once unless the group is already
+    // sorted. Lookups are always safe to share.
+    class GroupIndex {
+
+    public :
+        using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+        static constexpr size_t small_limit = 8;
+
+        // FNV-1a. Callers that look up the same key many times can hash it
+        // once and use find(name, hash).
+        static constexpr uint64_t hash(std::string_view s) {
+            uint64_t h = 0xcbf29ce484222325ull;
+            for (unsigned char c : s) {
+                h ^= c;
+                h *= 0x100000001b3ull;
+            }
+            return h;
+        }
+
+    private :
+
+        struct key_ref {
+            uint32_t offset;
+            uint32_t len;
+            uint32_t hash;
+        };
+
+        std::pmr::vector<char> chars_;
+        std::pmr::vector<key_ref> keys_;
+
+        // Positions, sorted by key when sorted_ is set.
+        mutable std::pmr::vector<uint32_t> order_;
+        mutable bool sorted_ = true;
+
+        // Open addressing, linear probing. 0 is empty, otherwise the
+        // position + 1. Only used once the group is past small_limit.
+        std::pmr::vector<uint32_t> table_;
+
+        std::string_view key_of(uint32_t pos) const {
+            auto &k = keys_[pos];
+            return {chars_.data() + k.offset, k.len};
+        }
+
+        void table_insert(uint32_t pos) {
+            size_t mask = table_.size() - 1;
+            size_t slot = keys_[pos].hash & mask;
+            while (table_[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            table_[slot] = pos + 1;
+        }
+
+        // Keep the load factor at or under one half for `n` keys.
+        void grow_table(size_t n) {
+            size_t want = 64;
+            while (want < n * 2) {
+                want *= 2;
+            }
+            if (table_.size() >= want) return;
+
+            table_.assign(want, 0);
+            for (uint32_t pos = 0; pos < keys_.size(); ++pos) {
+                table_insert(pos);
+            }
+        }
+
+        int find_small(std::string_view name) const {
+            auto iter = std::lower_bound(order_.begin(), order_.end(), name,
+                [this](uint32_t pos, std::string_view n) { return key_of(pos) < n; });
+            if (iter != order_.end() and key_of(*iter) == name) {
+                return int(*iter);
+            }
+            return -1;
+        }
+
+    public :
+        explicit GroupIndex(const allocator_type &a = {}) :
+            chars_(a), keys_(a), order_(a), table_(a) {}
+
+        GroupIndex(const GroupIndex &o, const allocator_type &a = {}) :
+            chars_(o.chars_, a), keys_(o.keys_, a), order_(o.order_, a),
+            sorted_{o.sorted_}, table_(o.table_, a) {}
+
+        GroupIndex &operator=(const GroupIndex &) = default;
+
+        // Make room for `n` keys in all.
+        void reserve(size_t n) {
+            keys_.reserve(n);
+            order_.reserve(n);
+            if (n > small_limit) {
+                grow_table(n);
+            }
+        }
+
+        size_t size() const { return keys_.size(); }
+
+        bool empty() const { return keys_.empty(); }
+
+        // The key at position `pos`.
+        std::string_view key(int pos) const { return key_of(uint32_t(pos)); }
+
+        // The position of `name`, or -1.
+        int find(std::string_view name) const {
+            if (table_.empty()) {
+                return find_small(name);
+            }
+            return find(name, hash(name));
+        }
+
+        // The same, with the hash of `name` already worked out.
+        int find(std::string_view name, uint64_t h) const {
+            if (table_.empty()) {
+                return find_small(name);
+            }
+
+            uint32_t h32 = uint32_t(h);
+            size_t mask = table_.size() - 1;
+            for (size_t slot = h32 & mask; table_[slot] != 0; slot = (slot + 1) & mask) {
+                uint32_t pos = table_[slot] - 1;
+                auto &k = keys_[pos];
+                if (k.hash == h32 and k.len == name.size()
+                        and std::memcmp(chars_.data() + k.offset, name.data(), k.len) == 0) {
+                    return int(pos);
+                }
+            }
+            return -1;
+        }
+
+        // Add `name` at the next position. Returns false, and changes
+        // nothing, if it is already there.
+        bool insert(std::string_view name) {
+            uint64_t h = hash(name);
+            if (find(name, h) >= 0) {
+                return false;
+            }
+
+            uint32_t pos = uint32_t(keys_.size());
+            keys_.push_back(key_ref{uint32_t(chars_.size()), uint32_t(name.size()), uint32_t(h)});
+            chars_.insert(chars_.end(), name.begin(), name.end());
+
+            if (table_.empty() and keys_.size() <= small_limit) {
+                // Keep the small list sorted as we go.
+                auto iter = std::lower_bound(order_.begin(), order_.end(), name,
+                    [this](uint32_t p, std::string_view n) { return key_of(p) < n; });
+                order_.insert(iter, pos);
+            } else {
+                order_.push_back(pos);
+                sorted_ = false;
+                if (table_.size() < keys_.size() * 2) {
+                    grow_table(keys_.size());
+                } else {
+                    table_insert(pos);
+                }
+            }
+            return true;
+        }
+
+        // Positions in alphabetical order of their keys.
+        const std::pmr::vector<uint32_t> &sorted() const {
+            if (not sorted_) {
+                std::sort(order_.begin(), order_.end(),
+                    [this](uint32_t a, uint32_t b) { return key_of(a) < key_of(b); });
+                sorted_ = true;
+            }
+            return order_;
+        }
+
+        void clear() {
+            chars_.clear();
+            keys_.clear();
+            order_.clear();
+            sorted_ = true;
+            table_.clear();
+        }
+    };
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "parser_utils.hpp"
+#include "setting.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace simpleConfig {
+
+    // A place in a text. Both count from 0, lines as the parser counts
+    // them in its errors.
+    struct source_position {
+        int line = 0;
+        int column = 0;
+    };
+
+    // Turns offsets into a text (such as Setting::source_offset()) into
+    // lines and columns.
+    //
+    // Where each line starts is only found the first time a position is
+    // asked for, so holding one costs nothing until something goes wrong.
+    // After that each lookup is a binary search. Line breaks are those of
+    // the parser : '\n', '\f', and '\f' followed by '\n' as one. The
+    // first lookup may come from several threads at once.
+    class LineIndex {
+        std::string_view text_;
+
+        mutable std::once_flag built_;
+        mutable std::vector<uint32_t> starts_;
+
+        void build() const {
+            starts_.push_back(0);
+            const char *p = text_.data();
+            size_t n = text_.size();
+            for (size_t i = 0; i < n; ++i) {
+                if (p[i] == '\f' and i + 1 < n and p[i + 1] == '\n') {
+                    i += 1;
+                } else if (p[i] != '\n' and p[i] != '\f') {
+                    continue;
+                }
+                starts_.push_back(uint32_t(i + 1));
+            }
+        }
+
+    public :
+        explicit LineIndex(std::string_view text) : text_{text} {}
+
+        LineIndex(const LineIndex &) = delete;
+        LineIndex &operator=(const LineIndex &) = delete;
+
+        std::string_view text() const { return text_; }
+
+        source_position position(size_t offset) const {
+            std::call_once(built_, [this]() { build(); });
+            auto iter = std::upper_bound(starts_.begin(), starts_.end(), uint32_t(offset));
+            auto line = int(iter - starts_.begin()) - 1;
+            return {line, int(offset - starts_[size_t(line)])};
+        }
+
+        // For error_list. Empty if `s` has no place in the text.
+        parse_loc loc_of(const Setting &s) const {
+            auto offset = s.source_offset();
+            if (offset < 0 or size_t(offset) > text_.size()) {
+                return {};
+            }
+            return {text_.substr(size_t(offset)), int(offset), position(size_t(offset)).line};
+        }
+    };
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace simpleConfig {
+
+    // Run fn(0) ... fn(n - 1) on up to `threads` threads, the calling
+    // thread being one of them. Items are handed out one at a time in
+    // order, so a few big items don't hold up the rest. Returns when all
+    // are done. If any call throws, the first exception is rethrown after
+    // that; items not yet started are then skipped.
+    template <typename F>
+    void parallel_for(size_t n, unsigned threads, F &&fn) {
+        if (threads > n) {
+            threads = unsigned(n);
+        }
+        if (threads <= 1) {
+            for (size_t i = 0; i < n; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next{0};
+        std::exception_ptr error;
+        std::mutex error_lock;
+
+        auto work = [&]() {
+            while (true) {
+                size_t i = next.fetch_add(1, std::memory_order_relaxed);
+                if (i >= n) break;
+                try {
+                    fn(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock{error_lock};
+                    if (not error) error = std::current_exception();
+                    next.store(n, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (unsigned t = 1; t < threads; ++t) {
+            pool.emplace_back(work);
+        }
+        work();
+        for (auto &t : pool) {
+            t.join();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+}
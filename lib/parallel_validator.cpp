@@ -0,0 +1,164 @@
+#include <parallel_validator.hpp>
+#include <parallel.hpp>
+
+namespace simpleConfig {
+
+    bool ParallelValidator::validate(Setting *setting_ptr) {
+        if (threads <= 1 or not setting_ptr->is_group()) {
+            return ProgramValidator::validate(setting_ptr);
+        }
+
+        units_.clear();
+        steps_.clear();
+        next_step_ = 0;
+        collect(setting_ptr, program.root());
+
+        // The units share nothing : each is its own part of the tree, and
+        // the schema (and the line index) is only read.
+        {
+            trace_span span{trace, "check units", "validate"};
+            parallel_for(units_.size(), threads, [this](size_t i) {
+                auto &u = units_[i];
+                ProgramValidator v{program, u.errors};
+                v.defer_defaults = &u.defaults;
+                v.lines = lines;
+                v.trace = trace;
+                u.ok = v.run_group(u.group, *u.c);
+                u.error_count = v.error_count;
+            });
+        }
+
+        // The serial check holds back its defaults too : adding one to a
+        // group above the units would move the unit groups out from under
+        // their pending defaults.
+        std::vector<pending_default> serial_defaults;
+        auto *outer_defaults = defer_defaults;
+        defer_defaults = &serial_defaults;
+        has_checked_ = true;
+        bool ok = run_group(setting_ptr, program.root());
+        has_checked_ = false;
+        defer_defaults = outer_defaults;
+
+        // Each unit's defaults only go into its own groups.
+        {
+            trace_span span{trace, "add defaults", "validate"};
+            parallel_for(units_.size(), threads, [this](size_t i) {
+                auto &u = units_[i];
+                if (not u.taken) return;
+                for (auto &d : u.defaults) {
+                    d.group->add_child(program.key(*d.s), *d.s->dflt);
+                }
+            });
+        }
+        SC_STAT(if (stats) {
+            for (auto &u : units_) {
+                if (u.taken) stats->defaults_added += u.defaults.size();
+            }
+        })
+
+        // Then the serial ones, which were noted children first, so no
+        // group moves before its own defaults are in.
+        if (outer_defaults) {
+            outer_defaults->insert(outer_defaults->end(),
+                serial_defaults.begin(), serial_defaults.end());
+        } else {
+            for (auto &d : serial_defaults) {
+                d.group->add_child(program.key(*d.s), *d.s->dflt);
+            }
+            SC_STAT(if (stats) stats->defaults_added += serial_defaults.size();)
+        }
+
+        units_.clear();
+        steps_.clear();
+        return ok;
+    }
+
+    bool ParallelValidator::take_checked(Setting *group, const check &c, bool &ok) {
+        // The serial check meets the groups in the order they were
+        // collected, perhaps skipping some.
+        size_t n = next_step_;
+        while (n < steps_.size() and steps_[n].group != group) {
+            n += 1;
+        }
+        if (n == steps_.size() or steps_[n].unit < 0) {
+            if (n < steps_.size()) next_step_ = n + 1;
+            return false;
+        }
+        next_step_ = n + 1;
+
+        auto &u = units_[size_t(steps_[n].unit)];
+        if (has_errors()) {
+            // The unit was checked as if there had been no errors before
+            // it; check it again the way the serial check would.
+            has_checked_ = false;
+            ok = run_group(group, c);
+            has_checked_ = true;
+            return true;
+        }
+
+        errors.errors.splice(errors.errors.end(), u.errors.errors);
+        error_count += u.error_count;
+        u.taken = true;
+        ok = u.ok;
+        return true;
+    }
+
+    bool ParallelValidator::has_large_array(Setting *group) const {
+        for (auto &child : *group) {
+            if (child.is_group()) {
+                if (has_large_array(&child)) return true;
+            } else if (child.is_array() and child.array_type() == ValType::GROUP) {
+                if (size_t(child.count()) >= min_split) return true;
+                for (auto &element : child) {
+                    if (has_large_array(&element)) return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void ParallelValidator::visit_group(Setting *group, const check &c, bool split) {
+        if (split or not has_large_array(group)) {
+            steps_.push_back(step{group, int(units_.size())});
+            units_.emplace_back();
+            units_.back().group = group;
+            units_.back().c = &c;
+        } else {
+            collect(group, c);
+        }
+    }
+
+    // The walk of run_group() and run_array(), without the checks.
+    void ParallelValidator::collect(Setting *group, const check &c) {
+        steps_.push_back(step{group, -1});
+
+        auto &b = program.block_of(c);
+        const check *star = (b.star >= 0) ? &program.at(uint32_t(b.star)) : nullptr;
+
+        for (const auto& [name, setting] : group->entries()) {
+            const check *snode = star;
+            int n = program.find(b, name);
+            if (n >= 0) {
+                snode = &program.at(program.slot_at(b, uint32_t(n)).check);
+            }
+            if (not snode) {
+                continue;
+            }
+
+            if (setting.is_group()) {
+                visit_group(&setting, *snode, false);
+            } else if (setting.is_array() and snode->array_type == ValType::GROUP
+                    and setting.array_type() == ValType::GROUP) {
+                bool split = (size_t(setting.count()) >= min_split);
+                if (split) {
+                    units_.reserve(units_.size() + size_t(setting.count()));
+                    steps_.reserve(steps_.size() + size_t(setting.count()));
+                }
+                for (auto &element : setting) {
+                    visit_group(&element, *snode, split);
+                }
+            }
+        }
+    }
+
+}
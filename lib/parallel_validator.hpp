@@ -0,0 +1,78 @@
+#pragma once
+
+#include "schema_program.hpp"
+
+#include <vector>
+
+namespace simpleConfig {
+
+    // A ProgramValidator that checks parts of the config on several
+    // threads. The errors, their order, the result and the defaults added
+    // are exactly those of ProgramValidator.
+    //
+    // A first pass walks the top of the tree and cuts it into units :
+    // groups with no large array of groups below them, and the elements
+    // of large arrays of groups (min_split elements or more). The units
+    // are checked at the same time, each into its own error list, and
+    // their defaults are only noted. Then the tree is checked as usual on
+    // the calling thread, which takes the result of each unit as it comes
+    // to it and moves its errors over. Its own defaults are only noted as
+    // well. Last, the defaults of the units taken are added, again on
+    // several threads, and then those of the serial check. Adding them
+    // allocates from the tree's memory resource on those threads, so it
+    // has to be safe to share (Config sees to that in arena mode).
+    //
+    // A unit's result is only good if there were no errors before it
+    // (the result of a group depends on that). Past the first error the
+    // units are checked again in place instead, so a config with errors
+    // can take longer than with ProgramValidator, but never comes out
+    // different. Units the serial check never gets to (array elements
+    // after a failed one) are dropped, defaults and all.
+    //
+    // Deferred groups are not supported; validate a lazy tree with
+    // ProgramValidator.
+    struct ParallelValidator : public ProgramValidator {
+
+        unsigned threads;
+
+        // Arrays of groups with at least this many elements are split
+        // element by element.
+        size_t min_split = 64;
+
+        ParallelValidator(const SchemaProgram &p, error_list &errlist, unsigned n) :
+            ProgramValidator{p, errlist}, threads{n}
+        {}
+
+        bool validate(Setting *setting_ptr);
+
+    protected :
+        bool take_checked(Setting *group, const check &c, bool &ok) override;
+
+    private :
+        struct unit {
+            Setting *group;
+            const check *c;
+            error_list errors;
+            int error_count = 0;
+            bool ok = true;
+            bool taken = false;     // by the serial check
+            std::vector<pending_default> defaults;
+        };
+
+        // Every group the serial check may start on, in the order it
+        // would, with the unit for it or -1 if it is walked as usual.
+        struct step {
+            Setting *group;
+            int unit;
+        };
+
+        std::vector<unit> units_;
+        std::vector<step> steps_;
+        size_t next_step_ = 0;
+
+        bool has_large_array(Setting *group) const;
+        void visit_group(Setting *group, const check &c, bool split);
+        void collect(Setting *group, const check &c);
+    };
+
+}
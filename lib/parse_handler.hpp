@@ -0,0 +1,68 @@
+#pragma once
+
+#include "parser_utils.hpp"
+
+#include <string_view>
+
+namespace simpleConfig {
+
+    // Receives the events produced by the parser as it walks a config.
+    //
+    // The top level of a config is an implicit group; it does not get
+    // begin_group()/end_group() events. Inside a group each value is
+    // preceded by key(). Elements of arrays and lists are just a stream
+    // of values.
+    //
+    // Every event returns an Action :
+    //  - CONTINUE carries on.
+    //  - SKIP, from key() or a begin_*(), means the handler doesn't care
+    //    about that value. The parser still checks its syntax, but sends
+    //    no events for it (including the matching end_*()).
+    //  - STOP ends the parse right there. It is not treated as an error.
+    //  - REJECT, from key(), means the key is a duplicate in its group.
+    //    The parser records the error and stops.
+    //
+    struct ParseHandler {
+
+        enum class Action { CONTINUE, SKIP, STOP, REJECT };
+
+        // Where the parser is in the input. Set before the first event.
+        const parse_loc *loc = nullptr;
+
+        // Where the text of the current event starts, as an offset like
+        // loc->offset : the name for key(), the bracket for begin_*(),
+        // the value itself for the value events.
+        int start = 0;
+
+        virtual ~ParseHandler() = default;
+
+        virtual Action key(std::string_view) { return Action::CONTINUE; }
+
+        virtual Action begin_group() { return Action::CONTINUE; }
+        virtual Action end_group() { return Action::CONTINUE; }
+
+        // Sent, after key(), in place of a whole group value that the
+        // parser was told not to parse (see ParserBase::defer_level).
+        // It is given the text between the braces; only the brackets,
+        // strings and comments in it have been looked at.
+        virtual Action deferred_group(const parse_loc &) { return Action::CONTINUE; }
+
+        virtual Action begin_array() { return Action::CONTINUE; }
+        virtual Action end_array() { return Action::CONTINUE; }
+
+        virtual Action begin_list() { return Action::CONTINUE; }
+        virtual Action end_list() { return Action::CONTINUE; }
+
+        virtual Action bool_value(bool) { return Action::CONTINUE; }
+        virtual Action integer_value(long) { return Action::CONTINUE; }
+        virtual Action float_value(double) { return Action::CONTINUE; }
+
+        // The flag is true when the string points into the text being
+        // parsed (so it lives as long as that text). Otherwise the string
+        // is only good for the duration of the call.
+        virtual Action string_value(std::string_view, bool) {
+            return Action::CONTINUE;
+        }
+    };
+
+}
@@ -0,0 +1,56 @@
+#include <parse_stats.hpp>
+
+#include <ostream>
+
+namespace simpleConfig {
+
+    namespace {
+
+        const char *node_names[] = {
+            "none", "string", "bool", "integer",
+            "float", "group", "list", "array", "any"
+        };
+    }
+
+    void parse_stats::write_json(std::ostream &strm) const {
+        strm << "{\"compiled_in\":" << (compiled_in ? "true" : "false")
+            << ",\"config_bytes\":" << config_bytes
+            << ",\"schema_bytes\":" << schema_bytes
+            << ",\"nodes\":{";
+        for (size_t t = 0; t < sizeof(nodes) / sizeof(nodes[0]); ++t) {
+            strm << (t ? "," : "") << "\"" << node_names[t] << "\":" << nodes[t];
+        }
+        strm << "},\"max_depth\":" << max_depth
+            << ",\"schema_nodes\":" << schema_nodes
+            << ",\"allocations\":" << allocations
+            << ",\"string_bytes_copied\":" << string_bytes_copied
+            << ",\"escapes\":" << escapes
+            << ",\"defaults_added\":" << defaults_added
+            << ",\"schema_seconds\":" << schema_seconds
+            << ",\"parse_seconds\":" << parse_seconds
+            << ",\"validate_seconds\":" << validate_seconds
+            << "}";
+    }
+
+    std::ostream &operator<<(std::ostream &strm, const parse_stats &s) {
+        strm << "config bytes        : " << s.config_bytes << "\n"
+            << "schema bytes        : " << s.schema_bytes << "\n"
+            << "nodes               : " << s.total_nodes() << " (";
+        for (size_t t = 0; t < sizeof(s.nodes) / sizeof(s.nodes[0]); ++t) {
+            if (s.nodes[t] == 0) continue;
+            strm << " " << node_names[t] << " " << s.nodes[t];
+        }
+        strm << " )\n"
+            << "max depth           : " << s.max_depth << "\n"
+            << "schema nodes        : " << s.schema_nodes << "\n"
+            << "allocations         : " << s.allocations << "\n"
+            << "string bytes copied : " << s.string_bytes_copied << "\n"
+            << "escapes             : " << s.escapes << "\n"
+            << "defaults added      : " << s.defaults_added << "\n"
+            << "schema time         : " << s.schema_seconds * 1000 << " ms\n"
+            << "parse time          : " << s.parse_seconds * 1000 << " ms\n"
+            << "validate time       : " << s.validate_seconds * 1000 << " ms\n";
+        return strm;
+    }
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "value_type.hpp"
+
+#include <iosfwd>
+#include <cstddef>
+
+// Counting is only compiled in when SIMPLECONFIG_STATS is defined (the
+// SC_STATS option in CMake). Without it SC_STAT(...) is nothing at all,
+// and a parse_stats is never written to.
+#if defined(SIMPLECONFIG_STATS)
+#define SC_STAT(...) __VA_ARGS__
+#else
+#define SC_STAT(...)
+#endif
+
+namespace simpleConfig {
+
+    // What parsing and checking configs cost, for Config::stats(). The
+    // counts add up over every parse until clear() is called.
+    struct parse_stats {
+
+#if defined(SIMPLECONFIG_STATS)
+        static constexpr bool compiled_in = true;
+#else
+        static constexpr bool compiled_in = false;
+#endif
+
+        // Text parsed, of configs and of schemas.
+        size_t config_bytes = 0;
+        size_t schema_bytes = 0;
+
+        // Settings made by the parser, by ValType, and how deep inside
+        // groups, arrays and lists it went (the top level is 0).
+        size_t nodes[9] = {};
+        int max_depth = 0;
+
+        size_t schema_nodes = 0;
+
+        // Calls to the memory resource of the Setting tree.
+        size_t allocations = 0;
+
+        // String values copied into settings rather than borrowed from
+        // the text, and escapes decoded in them.
+        size_t string_bytes_copied = 0;
+        size_t escapes = 0;
+
+        // Defaults from the schema added to the tree.
+        size_t defaults_added = 0;
+
+        // Wall time, in seconds.
+        double schema_seconds = 0;
+        double parse_seconds = 0;
+        double validate_seconds = 0;
+
+        size_t node_count(ValType t) const { return nodes[size_t(t)]; }
+
+        size_t total_nodes() const {
+            size_t n = 0;
+            for (auto c : nodes) n += c;
+            return n;
+        }
+
+        void clear() { *this = parse_stats{}; }
+
+        // Add the counts of `o` to these.
+        void merge(const parse_stats &o) {
+            config_bytes += o.config_bytes;
+            schema_bytes += o.schema_bytes;
+            for (size_t t = 0; t < sizeof(nodes) / sizeof(nodes[0]); ++t) {
+                nodes[t] += o.nodes[t];
+            }
+            if (o.max_depth > max_depth) max_depth = o.max_depth;
+            schema_nodes += o.schema_nodes;
+            allocations += o.allocations;
+            string_bytes_copied += o.string_bytes_copied;
+            escapes += o.escapes;
+            defaults_added += o.defaults_added;
+            schema_seconds += o.schema_seconds;
+            parse_seconds += o.parse_seconds;
+            validate_seconds += o.validate_seconds;
+        }
+
+        // As one JSON object.
+        void write_json(std::ostream &strm) const;
+    };
+
+    std::ostream &operator<<(std::ostream &strm, const parse_stats &s);
+
+}
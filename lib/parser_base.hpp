@@ -4,6 +4,11 @@
 
 #include "error_reporter.hpp"
 #include "setting.hpp"
+#include "parse_handler.hpp"
+#include "setting_builder.hpp"
+#include "skip_scan.hpp"
+#include "parse_stats.hpp"
+#include "trace_recorder.hpp"
 
 #include <string>
 #include <string_view>
@@ -11,9 +16,12 @@
 #include <vector>
 #include <iostream>
 #include <charconv>
+#include <array>
 #include <sstream>
 
-#if NDEBUG
+// Define SIMPLECONFIG_TRACE to have the parsers print each function
+// they enter and leave.
+#ifndef SIMPLECONFIG_TRACE
 
 #define ENTER
 
@@ -45,12 +53,52 @@
 
 namespace simpleConfig {
 
+    // What kind of scalar can start with a given byte.
+    enum scalar_class : unsigned char {
+        scOther, scNumber, scQuote, scTrue, scFalse
+    };
+
+    constexpr std::array<unsigned char, 256> make_scalar_classes() {
+        std::array<unsigned char, 256> t{};
+        for (int c = '0'; c <= '9'; ++c) t[c] = scNumber;
+        t['+'] = scNumber;
+        t['-'] = scNumber;
+        t['"'] = scQuote;
+        t['t'] = scTrue;
+        t['T'] = scTrue;
+        t['f'] = scFalse;
+        t['F'] = scFalse;
+        return t;
+    }
+
+    inline constexpr std::array<unsigned char, 256> scalar_classes =
+        make_scalar_classes();
+
+    // The bytes skip_body() has to look at.
+    constexpr std::array<bool, 256> make_body_stops() {
+        std::array<bool, 256> t{};
+        for (char c : std::string_view{"{}[]()\"#/\n\f"}) {
+            t[static_cast<unsigned char>(c)] = true;
+        }
+        return t;
+    }
+
+    inline constexpr std::array<bool, 256> body_stops = make_body_stops();
+
     struct ParserBase : public ErrorReporter {
 
         std::string_view src_text;
 
         parse_loc current_loc;
 
+        // Where to count what the parse did, if anywhere. Only used when
+        // built with SIMPLECONFIG_STATS.
+        parse_stats *stats = nullptr;
+
+        // Given a span for the whole parse and one for each top level
+        // group, if set.
+        TraceRecorder *trace = nullptr;
+
 
         ParserBase(std::string_view text, const std::string &parser_name,
             error_list &errlist) :
@@ -217,7 +265,7 @@ namespace simpleConfig {
                 // integer in hex format - from_chars doesn't like the 0x prefix
                 // can't be anything else so commit.
                 long seen_num;
-                auto [ ptr, ec] = std::from_chars(current_loc.sv.data()+2,
+                auto [ ptr, ec] = std::from_chars(current_loc.sv.data(),
                         current_loc.sv.data()+current_loc.sv.size(), seen_num, 16);
                 if (ec == std::errc()) {
                     int pos = ptr-current_loc.sv.data();
@@ -343,8 +391,12 @@ namespace simpleConfig {
 
         //##############   match_string_value  ###############
         // Supports parsing strings "next" to each other as a single
-        // string
-        std::optional<std::string> match_string_value() {
+        // string.
+        //
+        // The returned view points into the source text when the string
+        // is a single literal without escapes. Otherwise the value is
+        // built in `buf` and the view points there.
+        std::optional<std::string_view> match_string_value(std::string &buf) {
             skip();
             ENTER;
 
@@ -352,10 +404,53 @@ namespace simpleConfig {
 
             // consume the opening quotes
             consume(1);
-            std::stringstream buf{};
+
+            std::string_view first{};
+            bool have_first = false;
+            bool in_buf = false;
+
+            // Collect a piece of the value. Only the first piece can be
+            // left in place - anything more means we need the buffer.
+            auto append = [&](std::string_view piece) {
+                if (in_buf) {
+                    buf.append(piece);
+                } else if (not have_first) {
+                    first = piece;
+                    have_first = true;
+                } else {
+                    buf.assign(first);
+                    buf.append(piece);
+                    in_buf = true;
+                }
+            };
+
+            // Escapes always need the buffer.
+            auto append_char = [&](char c) {
+                if (not in_buf) {
+                    buf.assign(first);
+                    have_first = true;
+                    in_buf = true;
+                }
+                buf.push_back(c);
+            };
 
             bool stop = false;
             while(not stop and not eoi()) {
+
+                // run of ordinary characters
+                size_t len = 0;
+                auto const &sv = current_loc.sv;
+                while (len < sv.size()) {
+                    char c = sv[len];
+                    if (c == '"' or c == '\\' or c == '\n' or c == '\0') break;
+                    ++len;
+                }
+                if (len > 0) {
+                    append(sv.substr(0, len));
+                    consume(len);
+                    continue;
+                }
+
                 char c = peek();
                 switch (c) {
                     case '\0' :
@@ -364,36 +459,37 @@ namespace simpleConfig {
                         break;
                     case '\\' :
                         if (match_chars(1, "\\fnrtx\"")) {
+                            SC_STAT(if (stats) stats->escapes += 1;)
                             switch(peek(1)) {
                             case 'f' :
-                                buf << '\f';
+                                append_char('\f');
                                 consume(2);
                                 break;
                             case 'n' :
-                                buf << '\n';
+                                append_char('\n');
                                 consume(2);
                                 break;
                             case '"' :
-                                buf << '"';
+                                append_char('"');
                                 consume(2);
                                 break;
                             case 'r' :
-                                buf << '\r';
+                                append_char('\r');
                                 consume(2);
                                 break;
                             case '\\' :
-                                buf << '\\';
+                                append_char('\\');
                                 consume(2);
                                 break;
                             case 't' :
-                                buf << '\t';
+                                append_char('\t');
                                 consume(2);
                                 break;
                             case 'x' :
                                 if (match_chars(2, "0123456789abcdefABCDEF") and
                                         match_chars(3, "0123456789abcdefABCDEF")) {
                                     char x = (peek(2) - '0') * 16 + (peek(3) - '0');
-                                    buf << x;
+                                    append_char(x);
                                     consume(4);
                                 } else {
                                     record_error("Bad hex escape in string");
@@ -414,12 +510,7 @@ namespace simpleConfig {
                         stop = true;
                         consume(1);
                         break;
-                    default:
-                        buf << c;
-                        // this will be slow - rethink.
-                        consume(1);
-                        break;
-                    }
+                }
                 if (stop) {
                     skip();
                     if (match_char('"')) {
@@ -429,42 +520,294 @@ namespace simpleConfig {
                 }
             }
 
-            RETURN(buf.str());
+            if (in_buf) {
+                RETURN(std::string_view{buf});
+            }
+            RETURN(first);
+        }
 
+        std::optional<std::string> match_string_value() {
+            std::string buf;
+            auto sv = match_string_value(buf);
+            if (sv) return std::string(*sv);
+            return std::nullopt;
         }
 
-        //##############   match_scalar_value  ###############
+        // When true, strings that can be used in place are stored as views
+        // into the source text rather than copied. Whoever owns the text
+        // must keep it alive as long as the settings.
+        bool borrow_strings = false;
 
-        bool match_scalar_value(Setting *parent) {
+        // Does the view point into the source text ?
+        bool in_source(std::string_view v) const {
+            return (v.data() >= src_text.data() and
+                    v.data() + v.size() <= src_text.data() + src_text.size());
+        }
+
+        void set_string(Setting *s, std::string_view v) {
+            if (borrow_strings and in_source(v)) {
+                s->set_view(v);
+            } else {
+                s->set_value(std::string(v));
+            }
+        }
+
+        //##############   lex_scalar  #######################
+        // Single pass recognizer for scalar values.
+        //
+        // The first byte picks the only kind of token that can start
+        // there. Numbers are scanned once to find the end of the lexeme
+        // and converted once. The rules are the same as trying
+        // match_bool_value(), match_integer_value(), match_double_value()
+        // and match_string_value() in turn - anything unusual (signed hex,
+        // inf/nan, out of range values, bad hex) is handed to that cascade
+        // so the corner cases stay exactly as they were.
+
+        struct scalar_token {
+            ValType type = ValType::NONE;
+            bool bool_value = false;
+            long int_value = 0;
+            double float_value = 0.0;
+            std::string_view string_value;
+            int offset = 0;         // where it starts
+        };
+
+        static bool is_digit(char c) { return (c >= '0' and c <= '9'); }
+
+        // Scan and convert a number. Returns false if the lexeme needs
+        // the slow path.
+        bool lex_number(scalar_token &tok) {
+            auto const &sv = current_loc.sv;
+            size_t len = sv.size();
+
+            if (len >= 2 and sv[0] == '0' and (sv[1] == 'x' or sv[1] == 'X')) {
+                long v;
+                auto [ ptr, ec ] = std::from_chars(sv.data() + 2, sv.data() + len, v, 16);
+                size_t pos = ptr - sv.data();
+                if (ec != std::errc() or (pos < len and std::isalnum(sv[pos]))) {
+                    return false;
+                }
+                consume(pos);
+                tok.type = ValType::INTEGER;
+                tok.int_value = v;
+                return true;
+            }
+
+            size_t pos = 0;
+            if (sv[0] == '+' or sv[0] == '-') pos += 1;
+            // from_chars doesn't accept a leading '+'
+            size_t start = (sv[0] == '+') ? 1 : 0;
+
+            size_t int_digits = 0;
+            while (pos < len and is_digit(sv[pos])) { ++pos; ++int_digits; }
+
+            bool is_float = false;
+            size_t frac_digits = 0;
+            if (pos < len and sv[pos] == '.') {
+                is_float = true;
+                ++pos;
+                while (pos < len and is_digit(sv[pos])) { ++pos; ++frac_digits; }
+            }
+
+            if (int_digits + frac_digits == 0) return false;
+
+            if (pos < len and (sv[pos] == 'e' or sv[pos] == 'E')) {
+                size_t epos = pos + 1;
+                if (epos < len and (sv[epos] == '+' or sv[epos] == '-')) ++epos;
+                if (epos >= len or not is_digit(sv[epos])) return false;
+                while (epos < len and is_digit(sv[epos])) ++epos;
+                pos = epos;
+                is_float = true;
+            }
+
+            // Must end at a word boundary. The cascade only ever looked at
+            // the first 100 characters, so leave long ones to it.
+            if ((pos < len and std::isalnum(sv[pos])) or pos >= 100) {
+                return false;
+            }
+
+            if (is_float) {
+                double v;
+                auto [ ptr, ec ] = std::from_chars(sv.data() + start, sv.data() + pos, v);
+                if (ec != std::errc() or ptr != sv.data() + pos) return false;
+                tok.type = ValType::FLOAT;
+                tok.float_value = v;
+            } else {
+                long v;
+                auto [ ptr, ec ] = std::from_chars(sv.data() + start, sv.data() + pos, v);
+                if (ec != std::errc() or ptr != sv.data() + pos) return false;
+                tok.type = ValType::INTEGER;
+                tok.int_value = v;
+            }
+
+            consume(pos);
+            return true;
+        }
+
+        bool lex_scalar(scalar_token &tok, std::string &buf) {
             skip();
             ENTER;
 
-            auto bv = match_bool_value();
-            if (bv) {
-                parent->set_value(*bv);
+            tok.type = ValType::NONE;
+            if (eoi()) RETURN_B(false);
+            tok.offset = current_loc.offset;
+
+            switch (scalar_classes[static_cast<unsigned char>(peek())]) {
+                case scTrue :
+                case scFalse :
+                    if (auto bv = match_bool_value()) {
+                        tok.type = ValType::BOOL;
+                        tok.bool_value = *bv;
+                        RETURN_B(true);
+                    }
+                    RETURN_B(false);
+
+                case scQuote :
+                    if (auto sv = match_string_value(buf)) {
+                        tok.type = ValType::STRING;
+                        tok.string_value = *sv;
+                        RETURN_B(true);
+                    }
+                    RETURN_B(false);
+
+                case scNumber :
+                    if (lex_number(tok)) {
+                        RETURN_B(true);
+                    }
+                    break;
+
+                default :
+                    RETURN_B(false);
+            }
+
+            // The slow path for numbers.
+            if (auto lv = match_integer_value()) {
+                tok.type = ValType::INTEGER;
+                tok.int_value = *lv;
                 RETURN_B(true);
             }
-            
-            auto lv = match_integer_value();
-            if (lv) {
-                parent->set_value(*lv);
+            if (auto dv = match_double_value()) {
+                tok.type = ValType::FLOAT;
+                tok.float_value = *dv;
                 RETURN_B(true);
             }
-
-            auto dv = match_double_value();
-            if (dv) {
-                parent->set_value(*dv);
+            if (auto sv = match_string_value(buf)) {
+                tok.type = ValType::STRING;
+                tok.string_value = *sv;
                 RETURN_B(true);
             }
 
-            auto sv = match_string_value();
-            if (sv) {
-                parent->set_value(*sv);
-                RETURN_B(true);
+            RETURN_B(false);
+        }
+
+        //##############   match_scalar_value  ###############
+
+        bool match_scalar_value(Setting *parent) {
+            skip();
+            ENTER;
+
+            scalar_token tok;
+            std::string buf;
+            if (not lex_scalar(tok, buf)) {
+                RETURN_B(false);
             }
 
+            switch (tok.type) {
+                case ValType::BOOL :
+                    parent->set_value(tok.bool_value);
+                    break;
+                case ValType::INTEGER :
+                    parent->set_value(tok.int_value);
+                    break;
+                case ValType::FLOAT :
+                    parent->set_value(tok.float_value);
+                    break;
+                default :
+                    set_string(parent, tok.string_value);
+                    break;
+            }
 
-            RETURN_B(false);
+            RETURN_B(true);
+        }
+
+        /***********************************************************
+         * Events
+         ***********************************************************/
+
+        using Action = ParseHandler::Action;
+
+        // Who gets the events for the values parsed by the
+        // parse_* functions below.
+        ParseHandler *handler = nullptr;
+
+        // > 0 while inside a subtree the handler asked to skip.
+        int skip_depth = 0;
+
+        // Set when the handler asks to stop.
+        bool stopped = false;
+
+        // When > 0, group values of the settings on this level (1 is the
+        // top) are not parsed; their text goes to the handler's
+        // deferred_group() instead.
+        int defer_level = 0;
+
+        // How many groups we are inside.
+        int group_depth = 0;
+
+        // Send an event to the handler unless we are skipping.
+        template <typename F>
+        Action emit(F &&event) {
+            if (not handler or skip_depth > 0 or stopped) {
+                return Action::CONTINUE;
+            }
+            auto action = event(*handler);
+            if (action == Action::STOP) {
+                stopped = true;
+            }
+            return action;
+        }
+
+        // Send a scalar token. `as` allows an integer to be sent as
+        // a float (for float arrays).
+        Action emit_scalar(const scalar_token &tok, ValType as) {
+            if (handler) handler->start = tok.offset;
+            switch (tok.type) {
+                case ValType::BOOL :
+                    return emit([&](ParseHandler &h) { return h.bool_value(tok.bool_value); });
+                case ValType::INTEGER :
+                    if (as == ValType::FLOAT) {
+                        return emit([&](ParseHandler &h) {
+                            return h.float_value(double(tok.int_value)); });
+                    }
+                    return emit([&](ParseHandler &h) { return h.integer_value(tok.int_value); });
+                case ValType::FLOAT :
+                    return emit([&](ParseHandler &h) { return h.float_value(tok.float_value); });
+                default :
+                    return emit([&](ParseHandler &h) {
+                        return h.string_value(tok.string_value, in_source(tok.string_value)); });
+            }
+        }
+
+        // Start a composite value whose bracket is at offset `at`. Returns
+        // true if its events are wanted; if not, everything up to the
+        // matching close_composite() is skipped.
+        template <typename F>
+        bool open_composite(int at, F &&event) {
+            if (handler) handler->start = at;
+            if (emit(event) == Action::SKIP) {
+                skip_depth += 1;
+                return false;
+            }
+            return true;
+        }
+
+        template <typename F>
+        void close_composite(bool wanted, F &&event) {
+            if (wanted) {
+                emit(event);
+            } else {
+                skip_depth -= 1;
+            }
         }
 
 
@@ -490,14 +833,13 @@ namespace simpleConfig {
         }
 
         //##############   parse_list     ##############
-        bool parse_list(Setting* setting) {
+        bool parse_list() {
             skip();
             while(1) {
                 if (peek() == ')') {
                     return true;
                 }
-                Setting *child = setting->try_add_child(ValType::NONE);
-                if (!parse_setting_value(child)) {
+                if (!parse_setting_value()) {
                     return false;
                 }
                 skip();
@@ -515,53 +857,68 @@ namespace simpleConfig {
 
         //##############   parse_setting_value ##############
 
-        bool parse_setting_value(Setting * setting, bool record_failure=true) {
+        bool parse_setting_value(bool record_failure=true) {
+            int at = current_loc.offset;
             if (peek() == '{') {
                 consume(1);
                 skip();
-                setting->make_group();
-                parse_group(setting);
+                bool wanted = open_composite(at, [](ParseHandler &h) { return h.begin_group(); });
+                group_depth += 1;
+                parse_group();
+                group_depth -= 1;
+                if (stopped) return false;
                 skip();
                 if (peek(0) != '}') {
                     record_error("Didn't find close of setting group");
                     return false;
                 }
                 consume(1);
+                close_composite(wanted, [](ParseHandler &h) { return h.end_group(); });
             } else if (peek() == '(') {
                 consume(1);
                 skip();
-                setting->make_list();
-                parse_list(setting);
+                bool wanted = open_composite(at, [](ParseHandler &h) { return h.begin_list(); });
+                parse_list();
+                if (stopped) return false;
                 skip();
                 if (peek() != ')') {
                     record_error("Didn't find close of setting list");
                     return false;
                 }
                 consume(1);
+                close_composite(wanted, [](ParseHandler &h) { return h.end_list(); });
             } else if (peek() == '[') {
                 consume(1);
                 skip();
-                setting->make_array();
-                parse_array(setting);
+                bool wanted = open_composite(at, [](ParseHandler &h) { return h.begin_array(); });
+                parse_array();
+                if (stopped) return false;
                 skip();
                 if (peek() != ']') {
                     record_error("Didn't find close of value array");
                     return false;
                 }
                 consume(1);
-            } else if (! match_scalar_value(setting)) {
-                if (record_failure) record_error("Expecting a value");
-                return false;
+                close_composite(wanted, [](ParseHandler &h) { return h.end_array(); });
+            } else {
+                scalar_token tok;
+                std::string buf;
+                if (! lex_scalar(tok, buf)) {
+                    if (record_failure) record_error("Expecting a value");
+                    return false;
+                }
+                emit_scalar(tok, tok.type);
             }
 
-            return true;
+            return not stopped;
         }
         //##############   setting ##########################
 
-        bool parse_setting(Setting * parent) {
+        bool parse_setting() {
             skip();
             ENTER;
 
+            int at = current_loc.offset;
             auto name = match_name();
             if ( ! name ) {
                 RETURN_B(false);
@@ -575,28 +932,36 @@ namespace simpleConfig {
             }
             consume(1);
 
-            auto new_setting = parent->try_add_child(*name, ValType::NONE);
+            if (handler) handler->start = at;
+            auto action = emit([&](ParseHandler &h) { return h.key(*name); });
 
-            if (!new_setting) {
+            if (action == Action::REJECT) {
                 record_error("Setting named "s + *name + " already defined in this context");
                 RETURN_B(false);
+            } else if (action == Action::STOP) {
+                RETURN_B(false);
             }
 
             skip();
-            bool retval = parse_setting_value(new_setting);
+            trace_span span{(group_depth == 0 and peek() == '{') ? trace : nullptr,
+                "parse group", "parse", *name};
+            if (action == Action::SKIP) skip_depth += 1;
+            bool retval = (group_depth + 1 == defer_level and peek() == '{') ?
+                parse_deferred_group() : parse_setting_value();
+            if (action == Action::SKIP) skip_depth -= 1;
             RETURN_B(retval);
             
         }
 
         //##############   parse_group #####################
 
-        bool parse_group(Setting * parent) {
+        bool parse_group() {
             skip();
             ENTER;
 
             bool at_least_one = false;
             while (1) {
-                if (!parse_setting(parent)) break;
+                if (!parse_setting()) break;
                 at_least_one = true;
 
                 if (match_chars(0, ";,")) {
@@ -608,57 +973,150 @@ namespace simpleConfig {
             RETURN_B(at_least_one);
         }
 
+        //##############   parse_deferred_group ###########
+        // A group value that goes to the handler as text.
+        bool parse_deferred_group() {
+            consume(1);
+            parse_loc body = current_loc;
+            if (not skip_body()) {
+                return false;
+            }
+            body.sv = body.sv.substr(0, current_loc.offset - body.offset);
+            consume(1);
+            emit([&](ParseHandler &h) { return h.deferred_group(body); });
+            return not stopped;
+        }
+
+        //##############   skip_body  #####################
+        // Move over the body of a group without parsing it, up to the
+        // '}' that closes it (which is left for the caller). Strings and
+        // comments are stepped over so that brackets in them don't count.
+        // Brackets of every kind nest; whether they actually match is
+        // found out when the body is parsed.
+        bool skip_body() {
+            const char *p = current_loc.sv.data();
+            size_t n = current_loc.sv.size();
+            size_t i = 0;
+            int depth = 0;
+            int lines = 0;
+
+            // Count a line break at p[i] and move past it.
+            auto line_break = [&]() {
+                if (p[i] == '\f' and i + 1 < n and p[i + 1] == '\n') {
+                    i += 1;
+                }
+                lines += 1;
+                i += 1;
+            };
+
+            while (i < n) {
+                char c = p[i];
+                if (not body_stops[static_cast<unsigned char>(c)]) {
+                    i += 1;
+                    continue;
+                }
 
-        //##############   parse_array    ##############
-        bool parse_array(Setting * setting) {
+                if (c == '\n' or c == '\f') {
+                    line_break();
 
-            skip();
-            ENTER;
+                } else if (c == '{' or c == '[' or c == '(') {
+                    depth += 1;
+                    i += 1;
 
-            // For the first one, it can be anything
-            do {
-                if (peek() == '{') {
-                    consume(1);
-                    auto *element = new Setting(ValType::GROUP);
-                    if (not parse_group(element)) {
-                        RETURN_B(false);
+                } else if (c == '}' or c == ']' or c == ')') {
+                    if (depth == 0) {
+                        consume(int(i));
+                        current_loc.line += lines;
+                        if (c != '}') {
+                            record_error("Didn't find close of setting group");
+                            return false;
+                        }
+                        return true;
                     }
-                    skip();
-                    if (! match_char('}')) {
-                        record_error("Did not see close brace for subgroup");
-                        RETURN_B(false);
+                    depth -= 1;
+                    i += 1;
+
+                } else if (c == '"') {
+                    i += 1;
+                    while (i < n and p[i] != '"') {
+                        if (p[i] == '\\') {
+                            i += 2;
+                        } else if (p[i] == '\n' or p[i] == '\f') {
+                            line_break();
+                        } else {
+                            i += 1;
+                        }
                     }
-                    consume(1);
-                    setting->add_child(*element);
-                    std::cout << "=== Array with group child now has array type = "
-                        << int(setting->array_type()) << "\n";
-                    break;
-                }
+                    i += 1;
 
-                auto bv = match_bool_value();
-                if (bv) {
-                    setting->add_child(*bv);
-                    break;
-                }
-                
-                auto lv = match_integer_value();
-                if (lv) {
-                    setting->add_child(*lv);
-                    break;
-                }
+                } else if (c == '#' or (c == '/' and i + 1 < n and p[i + 1] == '/')) {
+                    i += skip_scan::line_end(p + i, n - i);
 
-                auto dv = match_double_value();
-                if (dv) {
-                    setting->add_child(*dv);
-                    break;
+                } else if (c == '/' and i + 1 < n and p[i + 1] == '*') {
+                    i += 2;
+                    while (true) {
+                        i += skip_scan::block_stop(p + i, n - i, lines);
+                        if (i >= n or (i + 1 < n and p[i + 1] == '/')) break;
+                        i += 1;
+                    }
+                    i += 2;
+
+                } else {
+                    // a lone '/'
+                    i += 1;
                 }
+            }
 
-                auto sv = match_string_value();
-                if (sv) {
-                    setting->add_child(*sv);
-                    break;
+            record_error("Didn't find close of setting group");
+            return false;
+        }
+
+        // An element of an array that is a group.
+        bool parse_array_group() {
+            int at = current_loc.offset;
+            consume(1);
+            bool wanted = open_composite(at, [](ParseHandler &h) { return h.begin_group(); });
+            group_depth += 1;
+            bool ok = parse_group();
+            group_depth -= 1;
+            if (stopped) return false;
+            if (not ok) {
+                return false;
+            }
+            skip();
+            if (! match_char('}')) {
+                record_error("Did not see close brace for subgroup");
+                return false;
+            }
+            consume(1);
+            close_composite(wanted, [](ParseHandler &h) { return h.end_group(); });
+            return not stopped;
+        }
+
+        //##############   parse_array    ##############
+        bool parse_array() {
+
+            skip();
+            ENTER;
+
+            scalar_token tok;
+            std::string buf;
+
+            // Arrays must all be the same type. Set by the first element.
+            ValType atype = ValType::NONE;
+
+            // For the first one, it can be anything
+            if (peek() == '{') {
+                if (not parse_array_group()) {
+                    RETURN_B(false);
                 }
-            } while(false);
+                atype = ValType::GROUP;
+            } else if (lex_scalar(tok, buf)) {
+                atype = tok.type;
+                if (emit_scalar(tok, atype) == Action::STOP) {
+                    RETURN_B(false);
+                }
+            }
 
 
             while (1) {
@@ -668,164 +1126,120 @@ namespace simpleConfig {
                     skip();
                 }
 
-                if (setting->array_type() == ValType::GROUP) {
+                if (atype == ValType::GROUP) {
                     if (peek() != '{') {
                         break;
                     }
-                    consume(1);
-                    auto *element = new Setting(ValType::GROUP);
-                    if (not parse_group(element)) {
+                    if (not parse_array_group()) {
                         RETURN_B(false);
                     }
-                    skip();
-                    if (! match_char('}')) {
-                        record_error("Did not see close brace for subgroup");
-                        RETURN_B(false);
-                    }
-                    consume(1);
-                    setting->add_child(*element);
-
-                } else if (setting->array_type() == ValType::BOOL) {
-                    auto bv = match_bool_value();
-                    if (bv) {
-                        setting->add_child(*bv);
-                    } else {
-                        break;
-                    }
-
-                } else if (setting->array_type() == ValType::INTEGER) {
-                    auto lv = match_integer_value();
-                    if (lv) {
-                        setting->add_child(*lv);
-                    } else {
-                        break;
-                    }
+                    continue;
+                }
 
-                } else if (setting->array_type() == ValType::FLOAT) {
-                    auto dv = match_double_value();
-                    if (dv) {
-                        setting->add_child(*dv);
-                    } else {
-                        break;
-                    }
-                } else if (setting->array_type() == ValType::STRING) {
+                if (not lex_scalar(tok, buf)) {
+                    break;
+                }
 
-                    auto sv = match_string_value();
-                    if (sv) {
-                        setting->add_child(*sv);
-                    } else {
-                        break;
+                if (tok.type == atype or
+                        (atype == ValType::FLOAT and tok.type == ValType::INTEGER)) {
+                    // integers are welcome in a float array
+                    if (emit_scalar(tok, atype) == Action::STOP) {
+                        RETURN_B(false);
                     }
-                } else {
+                } else if (atype == ValType::NONE) {
                     throw std::runtime_error("Unexpected array_type");
+                } else {
+                    record_error("All values in an array must be the same type");
+                    RETURN_B(false);
                 }
             }
 
-            Setting tester{};
+            RETURN_B(true);
 
-            if (match_scalar_value(&tester)) {
-                record_error("All values in an array must be the same type");
-                RETURN_B(false);
-            }
+        }
 
-            RETURN_B(true);
+        //##############   parse_array (into a Setting) ###
+        // Used when something other than the parser's handler
+        // wants the array. `setting` must already be an array.
+        bool parse_array(Setting *setting) {
+            SettingBuilder builder{setting};
+            builder.borrow_strings = borrow_strings;
 
+            auto *saved = handler;
+            handler = &builder;
+            bool retval = parse_array();
+            handler = saved;
+
+            return retval;
         }
 
         /****************************************************************
         * SKIP Processing
+        *
+        * Whitespace runs and the bodies of comments are handed to the
+        * skip_scan kernels, which move through them a vector register
+        * at a time while keeping count of the line breaks crossed.
         ****************************************************************/
         bool skip() {
 
-            //
-            // States for the state machine
-            //
-            enum SKIP_STATE { skNormal, skLine, skBlock };
-
-            SKIP_STATE state = skNormal;
-
             //
             // we'll be using this a lot.
             // So abbreviate it with a reference.
             //
             auto &cl = current_loc;
 
-            //
-            // When we enter a comment, we'll record where it started.
-            // If, at the end, we're still looking for comment terminator,
-            // we can use this location to put out an error message.
-            //
-            parse_loc comment_loc;
-
-            bool skipping = true;
             int line_count = 0;
-            while (skipping and not eoi()) {
-
-                //std::cout << "Loop top pos = " << cl.offset <<
-                //    " state = " << state <<
-                //    " char = '" << peek() << "'\n";
-                switch (state) {
-                    case skNormal : // Normal state
-                        {
-                            int eol_count = at_line_end(0);
-                            if (eol_count > 0) {
-                                line_count += 1;
-                                consume(eol_count);
-                            } else if (std::isspace(peek(0))) {
-                                consume(1);
-                            } else if (peek(0) == '#') {
-                                //std::cout << "--- Saw hash comment start\n";
-                                comment_loc = cl;
-                                consume(2);
-                                state = skLine;
-                            } else if (check_string("//")) {
-                                //std::cout << "--- Saw line comment start\n";
-                                comment_loc = cl;
-                                consume(2);
-                                state = skLine;
-                            } else if (check_string("/*")) {
-                                //std::cout << "--- Saw block comment start\n";
-                                comment_loc = cl;
-                                consume(2);
-                                state = skBlock;
-                            } else {
-                                skipping = false;
-                            }
-                        }
-                        break;
-                    case skLine: // Line comment
-                        {
-                            int eol_count = at_line_end(0);
-                            if (eol_count > 0) {
-                                //std::cout << "--- line comment end\n";
-                                state = skNormal;
-                                line_count += 1;
-                                consume(eol_count);
-                            } else {
-                                consume(1);
-                            }
-                        }
-                        break;
-                    case skBlock: // Block comment
-                        if (match_string("*/")) {
-                            //std::cout << "--- block comment end\n";
-                            state = skNormal;
-                        } else {
-                            int eol_count = at_line_end(0);
-                            if (eol_count > 0) {
-                                line_count += 1;
-                                consume(eol_count);
-                            } else {
-                                consume(1);
-                            }
-                        }
-                        break;
+            while (not eoi()) {
+
+                char c = peek();
+
+                if (c == ' ' or (c >= '\t' and c <= '\r')) {
+                    consume(skip_scan::blanks(cl.sv.data(), cl.sv.size(), line_count));
+                    continue;
                 }
-            }
 
-            if (state != skNormal) {
-                record_error("Unterminated comment starting here", comment_loc);
-                return false;
+                bool hash = (c == '#');
+                if (not hash and c != '/') {
+                    break;
+                }
+
+                //
+                // When we enter a comment, we'll record where it started.
+                // If we run out of input looking for the terminator,
+                // we can use this location to put out an error message.
+                //
+                parse_loc comment_loc = cl;
+                comment_loc.line += line_count;
+
+                if (hash or check_string("//")) {
+                    consume(hash ? 1 : 2);
+                    auto len = skip_scan::line_end(cl.sv.data(), cl.sv.size());
+                    consume(len);
+                    if (eoi()) {
+                        record_error("Unterminated comment starting here", comment_loc);
+                        return false;
+                    }
+                    line_count += 1;
+                    consume(at_line_end(0));
+
+                } else if (check_string("/*")) {
+                    consume(2);
+                    while (1) {
+                        auto len = skip_scan::block_stop(cl.sv.data(),
+                                cl.sv.size(), line_count);
+                        consume(len);
+                        if (eoi()) {
+                            record_error("Unterminated comment starting here", comment_loc);
+                            return false;
+                        }
+                        if (match_string("*/")) break;
+                        consume(1);
+                    }
+
+                } else {
+                    // a lone '/'
+                    break;
+                }
             }
 
             current_loc.line += line_count;
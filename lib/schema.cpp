@@ -0,0 +1,30 @@
+#include <schema.hpp>
+#include <schema_parser.hpp>
+#include <schema_program.hpp>
+#include <snapshot.hpp>
+
+namespace simpleConfig {
+
+    Schema::Schema() = default;
+
+    Schema::~Schema() = default;
+
+    std::shared_ptr<const Schema> Schema::parse(std::string_view text, error_list &errors,
+            parse_stats *stats) {
+        // Not make_shared : the constructor is private.
+        std::shared_ptr<Schema> schema{new Schema()};
+        schema->root_ = std::make_unique<SchemaNode>();
+
+        SchemaParser parser{text, schema->root_.get(), errors};
+        parser.stats = stats;
+        if (not parser.do_parse()) {
+            return nullptr;
+        }
+
+        // The program points into the tree.
+        schema->program_ = std::make_unique<SchemaProgram>(*schema->root_);
+        schema->hash_ = snapshot::checksum(text);
+        return schema;
+    }
+
+}
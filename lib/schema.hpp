@@ -0,0 +1,48 @@
+#pragma once
+
+#include "parser_utils.hpp"
+#include "parse_stats.hpp"
+
+#include <memory>
+#include <string_view>
+#include <cstdint>
+
+namespace simpleConfig {
+
+    struct SchemaNode;
+    class SchemaProgram;
+
+    // A parsed and compiled schema. Nothing about it changes once it is
+    // made, so one Schema can be shared (see Config::set_schema()) by any
+    // number of Configs, and they may validate against it on several
+    // threads at once.
+    class Schema {
+
+        std::unique_ptr<SchemaNode> root_;
+        std::unique_ptr<SchemaProgram> program_;
+        uint64_t hash_ = 0;
+
+        Schema();
+
+    public :
+        ~Schema();
+
+        Schema(const Schema &) = delete;
+        Schema &operator=(const Schema &) = delete;
+
+        // Parse and compile `text`. Returns null, with the reasons added
+        // to `errors`, if the schema has errors. The parse is counted in
+        // `stats` if given.
+        static std::shared_ptr<const Schema> parse(std::string_view text, error_list &errors,
+                parse_stats *stats = nullptr);
+
+        const SchemaNode &root() const { return *root_; }
+
+        const SchemaProgram &program() const { return *program_; }
+
+        // A hash of the schema text. Part of the name of parse cache
+        // entries.
+        uint64_t hash() const { return hash_; }
+    };
+
+}
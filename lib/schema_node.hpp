@@ -3,10 +3,13 @@
 #include "value_type.hpp"
 #include "range.hpp"
 #include "setting.hpp"
+#include "enum_set.hpp"
 
 #include <map>
 #include <string>
+#include <vector>
 #include <memory>
+#include <cstdint>
 
 
 namespace simpleConfig {
@@ -29,12 +32,49 @@ namespace simpleConfig {
         std::unique_ptr<Setting> dflt;
         std::unique_ptr<Setting> enum_values;
 
-        std::map<std::string, SchemaNode> subkeys;
+        // The members of enum_values, for lookups. Set both with set_enum().
+        EnumSet enum_set;
+
+        std::map<std::string, SchemaNode, std::less<>> subkeys;
+
+        // The subkeys other than "*" are numbered 0, 1, ... in key order,
+        // so a group's keys can be tracked in a bitset. `slots` has them by
+        // number, and `needed` has a bit for each one that is required or
+        // has a default. Set by index_slots(), and out of date once
+        // add_subkey() adds to the node (slots_current says which).
+        uint32_t slot = 0;
+        std::vector<const SchemaNode *> slots;
+        std::vector<uint64_t> needed;
+        bool slots_current = false;
+
+        // Number the subkeys of this node and everything below it. Run
+        // once the tree is built; SchemaParser does so.
+        void index_slots() {
+            slots.clear();
+            for (auto &[key, sub] : subkeys) {
+                if (key != "*") {
+                    sub.slot = uint32_t(slots.size());
+                    slots.push_back(&sub);
+                }
+                sub.index_slots();
+            }
+
+            needed.assign((slots.size() + 63) / 64, 0);
+            for (auto *sub : slots) {
+                if (sub->required or sub->dflt) {
+                    needed[sub->slot / 64] |= uint64_t(1) << (sub->slot % 64);
+                }
+            }
+            slots_current = true;
+        }
 
+        // Validator falls back to looking keys up one by one in a node
+        // given subkeys after index_slots(); run it again to avoid that.
         SchemaNode* add_subkey(const std::string &name) {
             auto [iter, done]  = subkeys.emplace(name, SchemaNode{name});
 
             if (done) {
+                slots_current = false;
                 return &(iter->second);
             } else {
                 return nullptr;
@@ -42,6 +82,16 @@ namespace simpleConfig {
 
         }
 
+        // Take ownership of the `_enum` list and index it.
+        void set_enum(Setting *values) {
+            enum_values.reset(values);
+            if (values) {
+                enum_set.assign(*values);
+            } else {
+                enum_set.clear();
+            }
+        }
+
         bool is_scalar() const {
             return (
                 vtype == ValType::INTEGER or
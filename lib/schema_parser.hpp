@@ -23,19 +23,21 @@ using VT = simpleConfig::ValType;
 namespace simpleConfig {
 
     struct type_info {
+        std::string_view name;
         ValType vtype = ValType::NONE;
         bool normal = true;
     };
 
-    std::map<std::string, type_info>type_map = {
-        {"int", {ValType::INTEGER, true}},
-        {"bool", {ValType::BOOL, true}},
-        {"float", {ValType::FLOAT, true}},
-        {"string", {ValType::STRING, true}},
-        {"any", {ValType::ANY, true}},
-        {"group", {ValType::GROUP, false}},
-        {"array", {ValType::ARRAY, false}},
-        {"list", {ValType::LIST, false}}
+    // The type names, tried in this order.
+    inline constexpr type_info type_table[] = {
+        {"any", ValType::ANY, true},
+        {"array", ValType::ARRAY, false},
+        {"bool", ValType::BOOL, true},
+        {"float", ValType::FLOAT, true},
+        {"group", ValType::GROUP, false},
+        {"int", ValType::INTEGER, true},
+        {"list", ValType::LIST, false},
+        {"string", ValType::STRING, true}
     };
 
 
@@ -158,16 +160,13 @@ namespace simpleConfig {
             ValType vtype = VT::NONE;
 
 
-            for (auto const &iter : type_map ){
-                if (not extended and not iter.second.normal) {
-                    // std::cout << "Skipping type name '"s + iter.first + "'\n";
+            for (auto const &t : type_table) {
+                if (not extended and not t.normal) {
                     continue;
                 }
-                //std::cout << "Trying type name '"s + iter.first + "'\n";
 
-                if (match_string(iter.first)) {
-                    //std::cout << "--- Found '" + iter.first +"'\n";
-                    vtype = iter.second.vtype;
+                if (match_string(t.name)) {
+                    vtype = t.vtype;
                     break;
                 }
             }
@@ -283,6 +282,7 @@ namespace simpleConfig {
                 record_error("key spec for "s + *name + " already defined in this context");
                 return false;
             }
+            SC_STAT(if (stats) stats->schema_nodes += 1;)
 
             new_key_spec->required = required;
 
@@ -536,7 +536,7 @@ namespace simpleConfig {
                     RETURN_B(false);
                 }
 
-                parent->enum_values.reset(enum_setting);
+                parent->set_enum(enum_setting);
                 RETURN_B(true);
             }
 
@@ -667,6 +667,9 @@ namespace simpleConfig {
                 RETURN_B(false);
             }
 
+            schema->index_slots();
+            SC_STAT(if (stats) stats->schema_bytes += size_t(current_loc.offset);)
+
             if (! eoi()) {
                 std::stringstream ss;
 
@@ -0,0 +1,357 @@
+#include <schema_program.hpp>
+#include <group_index.hpp>
+
+#include <cstring>
+
+using namespace std::literals::string_literals;
+
+namespace simpleConfig {
+
+    namespace {
+
+        inline int lowest_bit(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(x);
+#else
+            int i = 0;
+            while (!(x & 1u)) { x >>= 1; ++i; }
+            return i;
+#endif
+        }
+    }
+
+    //############## compiling ####
+
+    SchemaProgram::SchemaProgram(const SchemaNode &root) {
+        compile(root);
+    }
+
+    SchemaProgram::op SchemaProgram::scalar_op(const SchemaNode &node, ValType stype) {
+
+        // The same decisions as Validator::validate_scalar().
+        switch (stype) {
+            case ValType::ANY :
+                return op::ANY;
+            case ValType::INTEGER :
+                if (node.int_range.limited) return op::INT_RANGE;
+                return node.enum_values ? op::INT_ENUM : op::TYPE;
+            case ValType::FLOAT :
+                if (node.float_range.limited) return op::FLOAT_RANGE;
+                return node.enum_values ? op::FLOAT_ENUM : op::TYPE;
+            case ValType::STRING :
+                return node.enum_values ? op::STRING_ENUM : op::TYPE;
+            default :
+                return op::TYPE;
+        }
+    }
+
+    uint32_t SchemaProgram::compile(const SchemaNode &node) {
+        // checks_ grows as the subkeys are compiled, so only hold on to
+        // the index.
+        auto index = uint32_t(checks_.size());
+        checks_.emplace_back();
+
+        {
+            check c{};
+            c.vtype = node.vtype;
+            c.array_type = node.array_type;
+            c.value_op = scalar_op(node, node.vtype);
+            c.element_op = scalar_op(node, node.array_type);
+            c.length_min = node.length.min;
+            c.length_max = node.length.max;
+            c.int_min = node.int_range.min;
+            c.int_max = node.int_range.max;
+            c.float_min = node.float_range.min;
+            c.float_max = node.float_range.max;
+            c.node = &node;
+            c.block = uint32_t(blocks_.size());
+            checks_[index] = c;
+        }
+
+        block b{};
+        b.first_slot = uint32_t(slots_.size());
+        b.star = -1;
+
+        std::vector<const SchemaNode *> children;
+        for (auto const &[name, sub] : node.subkeys) {
+            if (name == "*") {
+                continue;
+            }
+            slot s{};
+            s.hash = GroupIndex::hash(name);
+            s.offset = uint32_t(chars_.size());
+            s.len = uint32_t(name.size());
+            s.required = sub.required;
+            s.dflt = sub.dflt.get();
+            chars_.append(name);
+            slots_.push_back(s);
+            children.push_back(&sub);
+        }
+        b.slot_count = uint32_t(children.size());
+
+        size_t words = (b.slot_count + 63) / 64;
+        b.mask_begin = uint32_t(masks_.size());
+        masks_.resize(masks_.size() + words, 0);
+        for (uint32_t n = 0; n < b.slot_count; ++n) {
+            auto &s = slots_[b.first_slot + n];
+            if (s.required or s.dflt) {
+                masks_[b.mask_begin + n / 64] |= uint64_t(1) << (n % 64);
+            }
+        }
+
+        if (b.slot_count > GroupIndex::small_limit) {
+            uint32_t size = 16;
+            while (size < b.slot_count * 2) {
+                size *= 2;
+            }
+            b.table_begin = uint32_t(table_.size());
+            b.table_size = size;
+            table_.resize(table_.size() + size, 0);
+            for (uint32_t n = 0; n < b.slot_count; ++n) {
+                uint32_t mask = size - 1;
+                uint32_t at = uint32_t(slots_[b.first_slot + n].hash) & mask;
+                while (table_[b.table_begin + at] != 0) {
+                    at = (at + 1) & mask;
+                }
+                table_[b.table_begin + at] = n + 1;
+            }
+        }
+
+        auto block_index = uint32_t(blocks_.size());
+        blocks_.push_back(b);
+
+        for (uint32_t n = 0; n < children.size(); ++n) {
+            auto c = compile(*children[n]);
+            slots_[b.first_slot + n].check = c;
+        }
+
+        auto star = node.subkeys.find("*");
+        if (star != node.subkeys.end()) {
+            auto c = compile(star->second);
+            blocks_[block_index].star = int32_t(c);
+            blocks_[block_index].star_required = star->second.required;
+        }
+
+        return index;
+    }
+
+    int SchemaProgram::find(const block &b, std::string_view name) const {
+        uint64_t h = GroupIndex::hash(name);
+        auto matches = [&](uint32_t n) {
+            auto &s = slots_[b.first_slot + n];
+            return (s.hash == h and s.len == name.size()
+                and std::memcmp(chars_.data() + s.offset, name.data(), s.len) == 0);
+        };
+
+        if (b.table_size == 0) {
+            for (uint32_t n = 0; n < b.slot_count; ++n) {
+                if (matches(n)) return int(n);
+            }
+            return -1;
+        }
+
+        uint32_t mask = b.table_size - 1;
+        for (uint32_t at = uint32_t(h) & mask; table_[b.table_begin + at] != 0; at = (at + 1) & mask) {
+            uint32_t n = table_[b.table_begin + at] - 1;
+            if (matches(n)) return int(n);
+        }
+        return -1;
+    }
+
+    //############## running ####
+
+    bool ProgramValidator::validate(Setting *setting_ptr) {
+        auto &c = program.root();
+
+        if (setting_ptr->is_group()) {
+            return run_group(setting_ptr, c);
+        } else if (setting_ptr->is_array()) {
+            return run_array(setting_ptr, c);
+        } else if (setting_ptr->is_scalar()) {
+            return run_scalar(setting_ptr, c, c.vtype, c.value_op);
+        }
+        // This would be a list or ANY. No validations.
+        return true;
+    }
+
+    bool ProgramValidator::run_scalar(Setting *setting_ptr, const check &c,
+            ValType stype, op o) {
+
+        if (o == op::ANY) {
+            return true;
+        }
+
+        if (setting_ptr->get_type() != stype) {
+            fail("setting and schema value type don't match", setting_ptr);
+            return false;
+        }
+
+        switch (o) {
+            case op::INT_RANGE : {
+                auto v = setting_ptr->get<int>();
+                if (v > c.int_max || v < c.int_min) {
+                    fail("int value is out of range", setting_ptr);
+                    return false;
+                }
+                break;
+            }
+            case op::INT_ENUM : {
+                if (not c.node->enum_set.contains(setting_ptr->get<int>())) {
+                    fail("Int value is not in enum list", setting_ptr);
+                    return false;
+                }
+                break;
+            }
+            case op::FLOAT_RANGE : {
+                auto v = setting_ptr->get<double>();
+                if (v > c.float_max || v < c.float_min) {
+                    fail("float value is out of range", setting_ptr);
+                    return false;
+                }
+                break;
+            }
+            case op::FLOAT_ENUM : {
+                if (not c.node->enum_set.contains(setting_ptr->get<double>())) {
+                    fail("Float value is not in enum list", setting_ptr);
+                    return false;
+                }
+                break;
+            }
+            case op::STRING_ENUM : {
+                if (not c.node->enum_set.contains(setting_ptr->get<std::string_view>())) {
+                    fail("String value is not in enum list", setting_ptr);
+                    return false;
+                }
+                break;
+            }
+            default :
+                break;
+        }
+
+        return true;
+    }
+
+    bool ProgramValidator::run_array(Setting *setting_ptr, const check &c) {
+
+        trace_span span{trace_for(setting_ptr), "validate array", "validate"};
+
+        if (setting_ptr->array_type() != c.array_type) {
+            fail("Key has wrong type for array elements.", setting_ptr);
+            return false;
+        }
+
+        bool okay = true;
+
+        auto length = setting_ptr->count();
+        if (c.length_max > 0 && (length < c.length_min || length > c.length_max)) {
+            fail("Number of array elements is out of range", setting_ptr);
+            okay = false;
+        }
+
+        // Validator stops checking elements after the first failure.
+        if (valtype_is_scalar(c.array_type)) {
+            for (auto &child : *setting_ptr) {
+                if (not okay) break;
+                okay = run_scalar(&child, c, c.array_type, c.element_op);
+            }
+        } else if (c.array_type == ValType::GROUP) {
+            for (auto &child : *setting_ptr) {
+                if (not okay) break;
+                okay = run_group(&child, c);
+            }
+        }
+
+        return okay;
+    }
+
+    bool ProgramValidator::run_group(Setting *setting_ptr, const check &c) {
+
+        if (has_checked_) {
+            bool ok;
+            if (take_checked(setting_ptr, c, ok)) {
+                return ok;
+            }
+        }
+
+        trace_span span{trace_for(setting_ptr), "validate group", "validate"};
+
+        auto &b = program.block_of(c);
+        const check *star = (b.star >= 0) ? &program.at(uint32_t(b.star)) : nullptr;
+        bool saw_star_key = false;
+
+        // Which slots the config has.
+        size_t words = (b.slot_count + 63) / 64;
+        uint64_t small[4] = {0, 0, 0, 0};
+        std::vector<uint64_t> large;
+        uint64_t *seen = small;
+        if (words > 4) {
+            large.assign(words, 0);
+            seen = large.data();
+        }
+
+        for (const auto& [sett_name, setting] : setting_ptr->entries()) {
+            const check *snode = nullptr;
+
+            int n = program.find(b, sett_name);
+            if (n >= 0) {
+                seen[n / 64] |= uint64_t(1) << (n % 64);
+                snode = &program.at(program.slot_at(b, uint32_t(n)).check);
+            } else if (star) {
+                snode = star;
+                saw_star_key = true;
+            }
+
+            if (not snode) {
+                fail("Key = "s + std::string(sett_name) + " is not allowed.", &setting);
+            }
+
+            ValType ftype = snode ? snode->vtype : ValType::NONE;
+            if (ftype != ValType::ANY && setting.get_type() != ftype)
+                fail("Key = "s + std::string(sett_name) + " has wrong type.", &setting);
+
+            if (snode) {
+                if (setting.is_group()) {
+                    if (leave_deferred and setting.is_deferred()) {
+                        setting.deferred()->schema = snode->node;
+                    } else {
+                        run_group(&setting, *snode);
+                    }
+
+                } else if (setting.is_array()) {
+                    run_array(&setting, *snode);
+
+                } else if (setting.is_scalar()) {
+                    run_scalar(&setting, *snode, snode->vtype, snode->value_op);
+                }
+            }
+        }
+
+        if (star and b.star_required and not saw_star_key)
+            fail("Key = *"s + " requires a 'star' entry", setting_ptr);
+
+        // Required keys and defaults, in the order of the schema.
+        auto *needed = program.needed(b);
+        for (size_t w = 0; w < words; ++w) {
+            uint64_t missing = needed[w] & ~seen[w];
+            while (missing) {
+                auto bit = uint32_t(lowest_bit(missing));
+                missing &= missing - 1;
+
+                auto &s = program.slot_at(b, uint32_t(w * 64 + bit));
+                auto name = program.key(s);
+                if (s.required) {
+                    fail("Required key = "s + std::string(name) +
+                        " is not present.", setting_ptr);
+                } else if (defer_defaults) {
+                    defer_defaults->push_back({setting_ptr, &s});
+                } else {
+                    SC_STAT(if (stats) stats->defaults_added += 1;)
+                    setting_ptr->add_child(name, *s.dflt);
+                }
+            }
+        }
+
+        return not has_errors();
+    }
+
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "setting.hpp"
+#include "schema_node.hpp"
+#include "validator.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace simpleConfig {
+
+    // A SchemaNode tree flattened into a few arrays, so that checking a
+    // config walks tables instead of maps.
+    //
+    // Every SchemaNode becomes a `check` : the type the value must have
+    // and an opcode for the scalar test (worked out once for the value
+    // and once for array elements). The subkeys of a node become a block
+    // of `slot`s in the same (sorted) order as in the node, each with the
+    // hash of its key. Blocks wider than GroupIndex::small_limit also get
+    // an open addressing table. Each block has a bitmask of the slots that
+    // are required or have a default, so a group with every such key
+    // present is dealt with in one compare per 64 keys.
+    //
+    // Defaults are not copied : the program points into the tree it was
+    // compiled from, which must outlive it.
+    class SchemaProgram {
+
+    public :
+        // The scalar test to run on a value.
+        enum class op : unsigned char {
+            ANY,            // nothing to check
+            TYPE,           // the type only
+            INT_RANGE,
+            INT_ENUM,
+            FLOAT_RANGE,
+            FLOAT_ENUM,
+            STRING_ENUM
+        };
+
+        struct check {
+            ValType vtype;
+            ValType array_type;
+            op value_op;
+            op element_op;
+            uint32_t block;
+            long length_min, length_max;
+            long int_min, int_max;
+            double float_min, float_max;
+            const SchemaNode *node;     // also holds the enum_set
+        };
+
+        struct slot {
+            uint64_t hash;
+            uint32_t offset;    // key text in chars_
+            uint32_t len;
+            uint32_t check;
+            bool required;
+            const Setting *dflt;
+        };
+
+        struct block {
+            uint32_t first_slot;
+            uint32_t slot_count;
+            uint32_t table_begin;   // in table_; table_size 0 means none
+            uint32_t table_size;
+            uint32_t mask_begin;    // (slot_count + 63) / 64 words in masks_
+            int32_t star;           // check for '*', or -1
+            bool star_required;
+        };
+
+    private :
+        std::vector<check> checks_;
+        std::vector<block> blocks_;
+        std::vector<slot> slots_;
+        std::vector<uint32_t> table_;   // slot index + 1, 0 is empty
+        std::vector<uint64_t> masks_;
+
+        std::string chars_;
+
+        uint32_t compile(const SchemaNode &node);
+        static op scalar_op(const SchemaNode &node, ValType stype);
+
+    public :
+        explicit SchemaProgram(const SchemaNode &root);
+
+        // The check for the root of the schema.
+        const check &root() const { return checks_.front(); }
+
+        const check &at(uint32_t c) const { return checks_[c]; }
+
+        const block &block_of(const check &c) const { return blocks_[c.block]; }
+
+        const slot &slot_at(const block &b, uint32_t n) const {
+            return slots_[b.first_slot + n];
+        }
+
+        std::string_view key(const slot &s) const {
+            return {chars_.data() + s.offset, s.len};
+        }
+
+        // The bits of the slots of `b` that are required or have a default.
+        const uint64_t *needed(const block &b) const {
+            return masks_.data() + b.mask_begin;
+        }
+
+        // The position of `name` in `b`, or -1.
+        int find(const block &b, std::string_view name) const;
+    };
+
+
+    // Checks a config against a SchemaProgram. Records exactly the errors
+    // that Validator records for the SchemaNode tree it was compiled from,
+    // in the same order, and adds the same defaults.
+    struct ProgramValidator : public Validator {
+
+        const SchemaProgram &program;
+
+        // Where errors are said to be, if anywhere.
+        const parse_loc *at = nullptr;
+
+        // A default that belongs in `group`.
+        struct pending_default {
+            Setting *group;
+            const SchemaProgram::slot *s;
+        };
+
+        // When set, defaults are put here instead of being added to the
+        // tree.
+        std::vector<pending_default> *defer_defaults = nullptr;
+
+        ProgramValidator(const SchemaProgram &p, error_list &errlist) :
+            Validator{errlist}, program{p}
+        {}
+
+        virtual ~ProgramValidator() = default;
+
+        bool validate(Setting *setting_ptr);
+
+        using check = SchemaProgram::check;
+        using op = SchemaProgram::op;
+
+        // Check one scalar as the value of `c` (stype is c.vtype, op is
+        // c.value_op) or as an element of it (c.array_type, c.element_op).
+        bool run_scalar(Setting *setting_ptr, const check &c, ValType stype, op o);
+
+        bool run_group(Setting *setting_ptr, const check &c);
+
+        // `s` is the setting the error is about, for its line.
+        void fail(const std::string &msg, const Setting *s = nullptr) {
+            record_error(msg, at ? *at : where(s));
+        }
+
+    protected :
+        // Set to have take_checked() offered every group first.
+        bool has_checked_ = false;
+
+        // Returns true, with the result in the last argument, if the group
+        // was already dealt with.
+        virtual bool take_checked(Setting *, const check &, bool &) { return false; }
+
+    private :
+        bool run_array(Setting *setting_ptr, const check &c);
+    };
+
+}
@@ -1,11 +1,17 @@
 #pragma once
 
 #include "value_type.hpp"
+#include "group_index.hpp"
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
+#include <iterator>
+#include <memory_resource>
 #include <exception>
+#include <cstring>
+#include <cstdint>
+#include <new>
 #include <ctype.h>
 #include <sstream>
 #include <iostream>
@@ -15,33 +21,213 @@ using namespace std::literals::string_literals;
 using namespace std::literals::string_view_literals;
 
 namespace simpleConfig {
+
+    class Setting;
+    class GroupLoader;
+    class TraceRecorder;
+    struct SchemaNode;
+
+    // The text of a group that a lazy parse skipped over, kept until the
+    // group is first used. See Setting::defer().
+    struct deferred_body {
+        GroupLoader *loader = nullptr;
+
+        // Between the braces, and the line it starts on.
+        std::string_view text;
+        int line = 0;
+
+        // Set when checking the group against the schema was put off
+        // until it is loaded.
+        const SchemaNode *schema = nullptr;
+    };
+
+    // Fills in a deferred group. load() is called at most once per group,
+    // the first time its children are wanted.
+    class GroupLoader {
+    public :
+        virtual ~GroupLoader() = default;
+        virtual void load(Setting &group, const deferred_body &body) = 0;
+    };
+
     // These make up the Config Tree that
     // we give to the user.
     class Setting {
 
+    public :
+        // Settings are allocator aware. Every child, key and string below
+        // a Setting comes from the same memory resource as the Setting.
+        using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    private :
+
+        // Storage for groups, lists and arrays. It lives out of line so
+        // that scalar leaves don't carry it around.
+        struct Composite {
+            std::pmr::vector<Setting> children;
+
+            // lookup for groups. Position n names children[n].
+            GroupIndex group;
+
+            // Arrays must all be the same type. Set when the first child is added to the array.
+            ValType array_type = ValType::NONE;
+
+            // For a group that hasn't been loaded yet.
+            deferred_body pending;
+
+            explicit Composite(std::pmr::memory_resource *r) :
+                children(r), group(r) {}
+        };
+
+        // Where a string value is kept.
+        enum class str_kind : unsigned char {
+            INLINE,     // in v_.sso
+            HEAP,       // in v_.str, allocated from res_
+            BORROWED    // in v_.str, owned by someone else (see set_view)
+        };
+
+        static constexpr size_t inline_capacity = 24;
+
+        // Everything below this Setting is allocated from here.
+        std::pmr::memory_resource *res_;
+
+        // The value. Which member is live depends on type_ (and skind_
+        // for strings).
+        union {
+            bool b;
+            long i;
+            double f;
+            struct {
+                const char *ptr;
+                size_t len;
+            } str;
+            char sso[inline_capacity];
+            Composite *comp;
+        } v_;
+
         ValType type_;
+        str_kind skind_ = str_kind::INLINE;
+        unsigned char sso_len_ = 0;
+
+        // Where the setting was in the text it was parsed from, plus one;
+        // 0 if it wasn't parsed. This fits in what would otherwise be
+        // padding, so it costs no memory. See source_offset().
+        uint32_t src_ = 0;
+
+        static bool is_composite_type(ValType t) {
+            return (t == ValType::GROUP or t == ValType::LIST or t == ValType::ARRAY);
+        }
+
+        // Set up an empty value of type `t`. Anything held before must
+        // already have been released.
+        void init(ValType t) {
+            type_ = t;
+            skind_ = str_kind::INLINE;
+            sso_len_ = 0;
+            v_.i = 0;
+            if (is_composite_type(t)) {
+                void *mem = res_->allocate(sizeof(Composite), alignof(Composite));
+                v_.comp = new (mem) Composite(res_);
+            }
+        }
+
+        // Free whatever the value holds. The Setting is left as a NONE.
+        void release() {
+            if (type_ == ValType::STRING and skind_ == str_kind::HEAP) {
+                res_->deallocate(const_cast<char *>(v_.str.ptr), v_.str.len, 1);
+            } else if (is_composite_type(type_)) {
+                v_.comp->~Composite();
+                res_->deallocate(v_.comp, sizeof(Composite), alignof(Composite));
+            }
+            type_ = ValType::NONE;
+            skind_ = str_kind::INLINE;
+            sso_len_ = 0;
+            v_.i = 0;
+        }
+
+        // Make this an empty value of type `t` if it isn't one already.
+        void become(ValType t) {
+            if (type_ != t) {
+                release();
+                init(t);
+            }
+        }
+
+        // Hold a copy of `s`. Short strings are kept inline.
+        void store_string(std::string_view s) {
+            if (type_ == ValType::STRING and skind_ == str_kind::HEAP) {
+                res_->deallocate(const_cast<char *>(v_.str.ptr), v_.str.len, 1);
+            } else {
+                become(ValType::STRING);
+            }
+
+            if (s.size() <= inline_capacity) {
+                std::memcpy(v_.sso, s.data(), s.size());
+                sso_len_ = static_cast<unsigned char>(s.size());
+                skind_ = str_kind::INLINE;
+            } else {
+                auto *p = static_cast<char *>(res_->allocate(s.size(), 1));
+                std::memcpy(p, s.data(), s.size());
+                v_.str.ptr = p;
+                v_.str.len = s.size();
+                skind_ = str_kind::HEAP;
+            }
+        }
 
-        // scalar containers (maybe change to std::variant?)
-        long integer_;
-        double float_;
-        bool bool_;
-        std::string string_;
+        // Take over the value of `o`, which must use the same resource.
+        // `o` is left as a NONE.
+        void steal(Setting &o) noexcept {
+            v_ = o.v_;
+            type_ = o.type_;
+            skind_ = o.skind_;
+            sso_len_ = o.sso_len_;
+            o.type_ = ValType::NONE;
+            o.skind_ = str_kind::INLINE;
+        }
 
+        // Copy the value of `o` into this (empty) Setting, using res_.
+        // Borrowed strings are copied too, so a copy never depends on the
+        // text its original refers to.
+        void copy_from(const Setting &o) {
+            if (o.type_ == ValType::STRING) {
+                store_string(o.string_value());
+            } else if (is_composite_type(o.type_)) {
+                init(o.type_);
+                auto &from = o.kids();
+                v_.comp->children = from.children;
+                v_.comp->group = from.group;
+                v_.comp->array_type = from.array_type;
+            } else {
+                v_ = o.v_;
+                type_ = o.type_;
+            }
+        }
 
-        // container for the composite types
-        std::vector<Setting> children_;
+        std::string_view string_value() const {
+            if (skind_ == str_kind::INLINE) {
+                return {v_.sso, sso_len_};
+            }
+            return {v_.str.ptr, v_.str.len};
+        }
 
-        // lookup for groups. Allows at(std::string) to be O(1)
-        // The int is an index into children_
-        std::map<std::string, int> group_;
+        // The children, after loading them if the group was deferred.
+        // Everything that looks at them goes through here.
+        Composite &kids() const {
+            if (v_.comp->pending.loader) {
+                const_cast<Setting *>(this)->load_pending();
+            }
+            return *v_.comp;
+        }
 
-        // Arrays must all be the same type. Set when the first child is added to the array.
-        ValType array_type_ = ValType::NONE;
+        void load_pending() {
+            // Cleared first, as the loader adds children through kids().
+            auto body = take_deferred();
+            body.loader->load(*this, body);
+        }
 
-        void clear_subobjects() {
-            children_.clear();
-            group_.clear();
-            string_.clear();
+        // Add `name` to the group index, pointing at the next child.
+        // Returns false if the name is already there.
+        bool index_child(std::string_view name) {
+            return kids().group.insert(name);
         }
 
         template<class T>
@@ -63,157 +249,262 @@ namespace simpleConfig {
 
 
     public :
-        Setting(ValType t = ValType::BOOL) : type_{t} {}
+        Setting(ValType t = ValType::BOOL, const allocator_type &a = {}) :
+            res_{a.resource()} { init(t); }
+
+        Setting(bool b, const allocator_type &a = {}) :
+            res_{a.resource()} { init(ValType::BOOL); v_.b = b; }
+        Setting(int i, const allocator_type &a = {}) :
+            res_{a.resource()} { init(ValType::INTEGER); v_.i = i; }
+        Setting(long l, const allocator_type &a = {}) :
+            res_{a.resource()} { init(ValType::INTEGER); v_.i = l; }
+        Setting(double f, const allocator_type &a = {}) :
+            res_{a.resource()} { init(ValType::FLOAT); v_.f = f; }
+        Setting(const std::string &s, const allocator_type &a = {}) :
+            res_{a.resource()} { init(ValType::NONE); store_string(s); }
+        Setting(const char * c, const allocator_type &a = {}) :
+            res_{a.resource()} { init(ValType::NONE); store_string(c); }
+
+        // Copies use the default resource unless told otherwise.
+        Setting(const Setting &o, const allocator_type &a = {}) :
+            res_{a.resource()} { init(ValType::NONE); copy_from(o); }
+
+        // A moved Setting keeps its resource, so whole subtrees can be
+        // moved without copying.
+        // The place in the source goes with it, as vectors of children move
+        // their elements when they grow.
+        Setting(Setting &&o) noexcept : res_{o.res_}, src_{o.src_} { init(ValType::NONE); steal(o); }
+
+        Setting(Setting &&o, const allocator_type &a) : res_{a.resource()}, src_{o.src_} {
+            init(ValType::NONE);
+            if (*res_ == *o.res_) {
+                steal(o);
+            } else {
+                copy_from(o);
+            }
+        }
+
+        // Assignment keeps the resource of the target.
+        Setting &operator=(const Setting &o) {
+            if (this != &o) {
+                // `o` may live below this Setting, so copy before releasing.
+                Setting tmp{o, allocator_type{res_}};
+                release();
+                steal(tmp);
+            }
+            return *this;
+        }
+
+        Setting &operator=(Setting &&o) {
+            if (this != &o) {
+                Setting tmp{std::move(o)};
+                release();
+                if (*res_ == *tmp.res_) {
+                    steal(tmp);
+                } else {
+                    copy_from(tmp);
+                }
+            }
+            return *this;
+        }
 
-        Setting(bool b) : type_(ValType::BOOL), bool_(b) {}
-        Setting(int i) : type_(ValType::INTEGER), integer_(i) {}
-        Setting(long l) : type_(ValType::INTEGER), integer_(l) {}
-        Setting(double f) :  type_(ValType::FLOAT), float_(f) {}
-        Setting(std::string s) : type_(ValType::STRING), string_(s) {}
-        Setting(const char * c) : type_(ValType::STRING), string_(c) {}
+        ~Setting() { release(); }
+
+        allocator_type get_allocator() const { return allocator_type{res_}; }
 
         ValType get_type() const { return type_; }
 
-        class group_iterator;
-        class group_enumerator {
+        // Where this setting starts in the text it was parsed from : its
+        // key for a member of a group, its value for an element of an
+        // array or list. -1 if it wasn't parsed (defaults, copies,
+        // settings made by hand or read from a snapshot). See LineIndex
+        // for turning it into a line and column.
+        long source_offset() const { return long(src_) - 1; }
+
+        void set_source_offset(long offset) {
+            src_ = (offset >= 0 and offset < long(UINT32_MAX)) ? uint32_t(offset + 1) : 0;
+        }
+
+        // The order entries() and enumerate() visit the children of a
+        // group in.
+        enum class KeyOrder { ALPHABETICAL, INSERTION };
+
+        // Iterates over the children of a group along with their keys,
+        // without allocating. The keys are views into the group; they are
+        // good until it is changed.
+        class entry_iterator {
             friend class Setting;
-            friend class group_iterator;
-            Setting &parent_;
+            Setting *parent_;
+            const uint32_t *order_;     // nullptr means insertion order
+            size_t i_;
 
-            group_enumerator(Setting &p) : parent_{p} {}
+            entry_iterator(Setting *p, const uint32_t *o, size_t i) :
+                parent_{p}, order_{o}, i_{i} {}
 
             public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = std::pair<std::string_view, Setting &>;
+                using difference_type = std::ptrdiff_t;
+                using reference = value_type;
+                using pointer = void;
+
+                value_type operator*() const {
+                    int pos = order_ ? int(order_[i_]) : int(i_);
+                    auto &c = parent_->kids();
+                    return {c.group.key(pos), c.children[pos]};
+                }
 
-            group_iterator& begin() {
-                return *(new group_iterator{parent_, parent_.group_.begin()});
-            }
+                entry_iterator &operator++() {
+                    ++i_;
+                    return *this;
+                }
 
-            group_iterator& end() {
-                return *(new group_iterator(parent_, parent_.group_.end()));
-            }
+                entry_iterator operator++(int) {
+                    auto old = *this;
+                    ++i_;
+                    return old;
+                }
+
+                bool operator==(const entry_iterator &o) const { return (i_ == o.i_); }
+                bool operator!=(const entry_iterator &o) const { return (i_ != o.i_); }
+        };
+
+        class entry_range {
+            friend class Setting;
+            entry_iterator begin_;
+            entry_iterator end_;
+
+            entry_range(entry_iterator b, entry_iterator e) : begin_{b}, end_{e} {}
+
+            public:
+                entry_iterator begin() const { return begin_; }
+                entry_iterator end() const { return end_; }
+                size_t size() const { return end_.i_ - begin_.i_; }
         };
 
+        // The children of a group along with their keys, as
+        // std::pair<std::string_view, Setting &>. Nothing is allocated.
+        entry_range entries(KeyOrder order = KeyOrder::ALPHABETICAL) {
+            if (!is_group()) {
+                throw std::runtime_error("Can only enumerate groups");
+            }
+
+            auto &group = kids().group;
+            const uint32_t *o = (order == KeyOrder::ALPHABETICAL) ?
+                group.sorted().data() : nullptr;
+            return {{this, o, 0}, {this, o, group.size()}};
+        }
+
+        class group_enumerator;
+
+        // The iterators of enumerate() : entry_iterators that also have
+        // operator->, and throw if dereferenced at the end.
         class group_iterator {
             friend class group_enumerator;
-            Setting& parent_;
-            std::map<std::string, int>::iterator it_;
-            std::pair<std::string, Setting &> *output_ = nullptr;
-
-            group_iterator(Setting &p, std::map<std::string, int>::iterator i) :
-                parent_(p), it_(i) {
+            entry_iterator at_;
+            entry_iterator end_;
 
-                    if (it_ != parent_.group_.end()) {
-                        output_ = new std::pair<std::string, Setting &>(it_->first, 
-                                std::ref(parent_.children_.at(it_->second)));
-                    }
-                }
+            group_iterator(entry_iterator at, entry_iterator end) : at_{at}, end_{end} {}
 
+            // What operator-> points into.
+            struct arrow {
+                entry_iterator::value_type v;
+                entry_iterator::value_type *operator->() { return &v; }
+            };
 
             public:
-                ~group_iterator() {
-                    if (output_) delete output_;
-                }
-                std::pair<std::string, Setting &> operator*() {
-                    if (! output_) throw std::runtime_error("invalid iterator");
-                    return *output_;
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = entry_iterator::value_type;
+                using difference_type = std::ptrdiff_t;
+                using reference = value_type;
+                using pointer = void;
+
+                value_type operator*() const {
+                    if (at_ == end_) throw std::runtime_error("invalid iterator");
+                    return *at_;
                 }
-                std::pair<std::string, Setting &>* operator->() {
-                    if (! output_) throw std::runtime_error("invalid iterator");
-                    return output_;
-                }
-
-                group_iterator& operator++() {
-                    ++it_;
-                    if (output_) {
-                        delete output_;
-                        output_ = nullptr;
-                    }
 
-                    if (it_ != parent_.group_.end()) {
-                        output_ = new std::pair<std::string, Setting &>(it_->first, 
-                                std::ref(parent_.children_.at(it_->second)));
-                    }
-                    return *this;
+                arrow operator->() const {
+                    return arrow{**this};
                 }
 
-                bool operator==(const group_iterator *o) const {
-                    return (it_ == o->it_);
-                }
-                bool operator==(const group_iterator &o) const {
-                    return (it_ == o.it_);
-                }
-                bool operator!=(const group_iterator *o) const {
-                    return (it_ != o->it_);
-                }
-                bool operator!=(const group_iterator &o) const {
-                    return (it_ != o.it_);
+                group_iterator &operator++() {
+                    ++at_;
+                    return *this;
                 }
 
+                bool operator==(const group_iterator &o) const { return (at_ == o.at_); }
+                bool operator!=(const group_iterator &o) const { return (at_ != o.at_); }
         };
 
-        group_enumerator& enumerate() {
-            if (!is_group()) {
-                throw std::runtime_error("Can only enumerate groups");
-            }
+        class group_enumerator {
+            friend class Setting;
+            entry_range range_;
+
+            group_enumerator(entry_range r) : range_{r} {}
+
+            public:
+                group_iterator begin() const { return {range_.begin(), range_.end()}; }
+                group_iterator end() const { return {range_.end(), range_.end()}; }
+        };
 
-            return *(new group_enumerator(*this));
+        // Visit the children of a group along with their keys. By default
+        // they come in alphabetical order of the keys. The same as
+        // entries(), but its iterators check for the end.
+        group_enumerator enumerate(KeyOrder order = KeyOrder::ALPHABETICAL) {
+            return {entries(order)};
         }
 
         Setting & set_value(bool b) {
-            if (!is_boolean()) {
-                clear_subobjects();
-                type_ = ValType::BOOL;
-            }
-            bool_ = b;
+            become(ValType::BOOL);
+            v_.b = b;
             return *this;
         }
 
         Setting & set_value(int i) {
-            if (!is_integer()) {
-                clear_subobjects();
-                type_ = ValType::INTEGER;
-            }
-            integer_ = i;
+            become(ValType::INTEGER);
+            v_.i = i;
             return *this;
         }
 
         Setting & set_value(long i) {
-            if (!is_integer()) {
-                clear_subobjects();
-                type_ = ValType::INTEGER;
-            }
-            integer_ = i;
+            become(ValType::INTEGER);
+            v_.i = i;
             return *this;
         }
         
         Setting & set_value(double f) {
-            if (!is_float()) {
-                clear_subobjects();
-                type_ = ValType::FLOAT;
-            }
-            float_ = f;
+            become(ValType::FLOAT);
+            v_.f = f;
             return *this;
         }
 
 
         Setting & set_value(const std::string s) {
-            if (!is_string()) {
-                clear_subobjects();
-                type_ = ValType::STRING;
-            }
-            string_ = s;
+            store_string(s);
             return *this;
         }
 
         Setting & set_value(const char *c) {
-            if (!is_string()) {
-                clear_subobjects();
-                type_ = ValType::STRING;
-            }
-            string_ = c;
+            store_string(c);
+            return *this;
+        }
+
+        // Make this a string that refers to `v` rather than holding a copy.
+        // The caller is responsible for keeping the characters alive for as
+        // long as the Setting is in use. Copies of it hold their own.
+        Setting & set_view(std::string_view v) {
+            release();
+            init(ValType::STRING);
+            v_.str.ptr = v.data();
+            v_.str.len = v.size();
+            skind_ = str_kind::BORROWED;
             return *this;
         }
 
+        // Does the string value refer to storage outside the Setting ?
+        bool is_borrowed() const { return (is_string() and skind_ == str_kind::BORROWED); }
+
         bool is_boolean() const { return (type_ == ValType::BOOL); }
         bool is_integer() const { return (type_ == ValType::INTEGER); }
         bool is_float()   const { return (type_ == ValType::FLOAT); }
@@ -223,64 +514,96 @@ namespace simpleConfig {
         bool is_array()   const { return (type_ == ValType::ARRAY); }
 
         bool is_numeric()   const { return (is_integer() or is_float()); }
-        bool is_composite() const { return (valtype_is_composite(type_)); }
+        bool is_composite() const { return (is_composite_type(type_)); }
         bool is_scalar()    const { return (valtype_is_scalar(type_)); }
 
         void make_list() {
-            if (!is_list()) {
-                clear_subobjects();
-                type_ = ValType::LIST;
-            }
+            become(ValType::LIST);
         }
 
         void make_group() {
-            if (!is_group()) {
-                clear_subobjects();
-                type_ = ValType::GROUP;
-            }
+            become(ValType::GROUP);
         }
 
         void make_array() {
-            if (! is_array()) {
-                clear_subobjects();
-                type_ = ValType::ARRAY;
+            become(ValType::ARRAY);
+        }
+
+        // Make this an empty group whose children are filled in by
+        // `body.loader` the first time anything asks for them. Copying
+        // the group loads it first; a moved group stays deferred, so the
+        // loader and the text must outlive it.
+        void defer(const deferred_body &body) {
+            release();
+            init(ValType::GROUP);
+            v_.comp->pending = body;
+        }
+
+        // Is this a group that hasn't been loaded yet ?
+        bool is_deferred() const {
+            return (is_group() and v_.comp->pending.loader != nullptr);
+        }
+
+        // The body of a deferred group, or nullptr.
+        deferred_body *deferred() {
+            return is_deferred() ? &v_.comp->pending : nullptr;
+        }
+
+        // Hand back the body of a deferred group and treat the group as
+        // loaded, for callers that fill it in some other way. Returns an
+        // empty body if the group isn't deferred.
+        deferred_body take_deferred() {
+            if (not is_deferred()) {
+                return {};
+            }
+            auto body = v_.comp->pending;
+            v_.comp->pending = deferred_body{};
+            return body;
+        }
+
+        // Load a deferred group now. Does nothing otherwise.
+        void load() {
+            if (is_deferred()) {
+                load_pending();
             }
         }
 
-        bool exists(const std::string child) const {
+        bool exists(std::string_view child) const {
             if (! is_group()) return false;
 
-            auto const &iter = group_.find(child);
-            if (iter == group_.end()) 
-                return false;
-            else
-                return true;
+            return (kids().group.find(child) >= 0);
         }
 
         template<typename T> T get() const {
             if constexpr (std::is_same_v<T, bool>) {
                 if (is_boolean()) {
-                    return T(bool_);
+                    return T(v_.b);
                 } else {
                     throw std::runtime_error("Bad type conversion\n");
                 }
             } else if constexpr (std::is_integral_v<T>) {
                 if (is_integer())
-                    return T(integer_);
+                    return T(v_.i);
                 else 
                     throw std::runtime_error("Bad type conversion\n");
 
             } else if constexpr(std::is_floating_point_v<T>) {
                 if (is_float()) {
-                    return T(float_);
+                    return T(v_.f);
                 } else if (is_integer()) {
-                    return T(integer_);
+                    return T(v_.i);
+                } else {
+                    throw std::runtime_error("Bad type conversion\n");
+                }
+            } else if constexpr (std::is_same_v<T, std::string_view>) {
+                if (is_string()) {
+                    return string_value();
                 } else {
                     throw std::runtime_error("Bad type conversion\n");
                 }
             } else if constexpr (std::is_convertible_v<std::string, T>) {
                 if (is_string()) {
-                    return T(string_);
+                    return T(std::string(string_value()));
                 } else {
                     throw std::runtime_error("Bad type conversion\n");
                 }
@@ -299,17 +622,17 @@ namespace simpleConfig {
 
             } else if (is_array()) {
                 ValType target_type = deduce_scalar_type(v);
-                if (children_.size() > 0) {
-                    if (array_type_ != target_type) {
+                if (kids().children.size() > 0) {
+                    if (kids().array_type != target_type) {
                         throw std::runtime_error("All children of arrays must be the same type");
                     }
                 } else {
-                    array_type_ = target_type;
+                    kids().array_type = target_type;
                 }
-                return children_.emplace_back(v);
+                return kids().children.emplace_back(v);
 
             } else if (is_list()) {
-                return children_.emplace_back(v);
+                return kids().children.emplace_back(v);
 
             } else {
                 throw std::runtime_error("Setting must be composite to add child");
@@ -321,57 +644,57 @@ namespace simpleConfig {
                 throw std::runtime_error("Group children must have names");
 
             } else if (is_list()) {
-                return children_.emplace_back(t);
+                return kids().children.emplace_back(t);
 
             } else if (is_array()) {
                 if (valtype_is_composite(t)) {
                     throw std::runtime_error("Arrays may only have scalar children");
                 }
 
-                if (children_.size() > 0) {
-                    if (array_type_ != t) {
+                if (kids().children.size() > 0) {
+                    if (kids().array_type != t) {
                         throw std::runtime_error("All children of arrays must be the same type");
                     }
                 } else {
-                    array_type_ = t;
+                    kids().array_type = t;
                 }
-                return children_.emplace_back(t);
+                return kids().children.emplace_back(t);
             } else {
                 throw std::runtime_error("Setting must be composite to add child");
             }
         }
         
         template<class T>
-        Setting &add_child( const std::string &name, T v) {
+        Setting &add_child(std::string_view name, T v) {
 
             if (!is_group()) {
                 throw std::runtime_error("Only group children may have names");
             }
 
-            auto [ _, done ] = group_.try_emplace(name, int(group_.size()));
+            bool done = index_child(name);
 
             if (done) {
                 // It didn't exists before
-                return children_.emplace_back(v);
+                return kids().children.emplace_back(v);
             } else {
-                throw std::runtime_error("Child with given key "s + name + " already exists");
+                throw std::runtime_error("Child with given key "s + std::string(name) + " already exists");
 
             }
         }
 
-        Setting &add_child( const std::string &name, ValType t) {
+        Setting &add_child(std::string_view name, ValType t) {
 
             if (!is_group()) {
                 throw std::runtime_error("Only group children may have names");
             }
 
-            auto [ _, done ] = group_.try_emplace(name, int(group_.size()));
+            bool done = index_child(name);
 
             if (done) {
                 // It didn't exists before
-                return children_.emplace_back(t);
+                return kids().children.emplace_back(t);
             } else {
-                throw std::runtime_error("Child with given key "s + name + " already exists");
+                throw std::runtime_error("Child with given key "s + std::string(name) + " already exists");
 
             }
         }
@@ -385,17 +708,17 @@ namespace simpleConfig {
 
             } else if (is_array()) {
                 ValType target_type = deduce_scalar_type(v);
-                if (children_.size() > 0) {
-                    if (array_type_ != target_type) {
+                if (kids().children.size() > 0) {
+                    if (kids().array_type != target_type) {
                         return nullptr;
                     }
                 } else {
-                    array_type_ = target_type;
+                    kids().array_type = target_type;
                 }
-                return &(children_.emplace_back(v));
+                return &(kids().children.emplace_back(v));
 
             } else if (is_list()) {
-                return &(children_.emplace_back(v));
+                return &(kids().children.emplace_back(v));
 
             } else {
                 return nullptr;
@@ -409,72 +732,83 @@ namespace simpleConfig {
                 return nullptr;
 
             } else if (is_list()) {
-                return &(children_.emplace_back(t));
+                return &(kids().children.emplace_back(t));
 
             } else if (is_array()) {
                 if (valtype_is_composite(t) and t != ValType::GROUP) {
                     return nullptr;
                 }
 
-                if (children_.size() > 0) {
-                    if (array_type_ != t) {
+                if (kids().children.size() > 0) {
+                    if (kids().array_type != t) {
                         return nullptr;
                     }
                 } else {
-                    array_type_ = t;
+                    kids().array_type = t;
                 }
-                return &(children_.emplace_back(t));
+                return &(kids().children.emplace_back(t));
             } else {
                 return nullptr;
             }
         }
 
         template<class T>
-        Setting* try_add_child( const std::string &name, T v) {
+        Setting* try_add_child(std::string_view name, T v) {
 
             if (!is_group()) {
                 return nullptr;
             }
 
-            auto [ _, done ] = group_.try_emplace(name, group_.size());
+            bool done = index_child(name);
 
             if (done) {
                 // It didn't exists before
-                return &(children_.emplace_back(v));
+                return &(kids().children.emplace_back(v));
             } else {
                 return nullptr;
 
             }
         }
 
-        Setting* try_add_child( const std::string &name, ValType t) {
+        Setting* try_add_child(std::string_view name, ValType t) {
 
             if (!is_group()) {
                 return nullptr;
             }
 
-            auto [ _, done ] = group_.try_emplace(name, int(group_.size()));
+            bool done = index_child(name);
 
             if (done) {
                 // It didn't exists before
-                return &(children_.emplace_back(t));
+                return &(kids().children.emplace_back(t));
             } else {
                 return nullptr;
 
             }
         }
 
+        // Make room for `n` children, so that adding them doesn't move
+        // the ones already there. Does nothing for scalars.
+        void reserve(size_t n) {
+            if (is_composite()) {
+                kids().children.reserve(n);
+                if (is_group()) {
+                    kids().group.reserve(n);
+                }
+            }
+        }
+
         int count() const {
-            if (is_scalar()) {
+            if (not is_composite()) {
                 return 0;
             }
 
-            return int(children_.size());
+            return int(kids().children.size());
         }
 
         ValType array_type() const {
             if (is_array()) {
-                return array_type_;
+                return kids().array_type;
             }
 
             throw std::runtime_error("Setting is not an array");
@@ -491,15 +825,16 @@ namespace simpleConfig {
             //   0    1   2
             //   -    -   -
             //  -3   -2  -1
-            if (idx >= int(children_.size()) or idx < -int(children_.size())) {
+            auto &children = kids().children;
+            if (idx >= int(children.size()) or idx < -int(children.size())) {
                 throw std::runtime_error("at(int) called with index out of range");
             }
 
             if (idx < 0) {
-                idx += int(children_.size());
+                idx += int(children.size());
             }
 
-            return children_.at(idx);
+            return children.at(idx);
         }
 
         Setting *lkup(int idx) {
@@ -511,43 +846,62 @@ namespace simpleConfig {
             //   0    1   2
             //   -    -   -
             //  -3   -2  -1
-            if (idx >= int(children_.size()) or idx < -int(children_.size())) {
+            auto &children = kids().children;
+            if (idx >= int(children.size()) or idx < -int(children.size())) {
                 return nullptr;
             }
 
             if (idx < 0) {
-                idx += int(children_.size());
+                idx += int(children.size());
             }
 
-            return &(children_.at(idx));
+            return &(children.at(idx));
         }
 
 
-        Setting &at(const std::string& name) {
+        Setting &at(std::string_view name) {
             if (!is_group()) {
                 throw std::runtime_error("at(string) called on a non-group");
             }
 
-            auto iter = group_.find(name);
-            if (iter == group_.end()) {
-                throw std::runtime_error("at(string) : key "s + name + 
+            auto &c = kids();
+            int pos = c.group.find(name);
+            if (pos < 0) {
+                throw std::runtime_error("at(string) : key "s + std::string(name) + 
                         " does not exist in the group");
             }
 
-            return children_.at(iter->second);
+            return c.children[pos];
+        }
+
+        Setting *lkup(std::string_view name) {
+            if (!is_group()) {
+                return nullptr;
+            }
+
+            auto &c = kids();
+            int pos = c.group.find(name);
+            if (pos < 0) {
+                return nullptr;
+            }
+
+            return &(c.children[pos]);
         }
 
-        Setting *lkup(const std::string& name) {
+        // The same, with the hash of `name` (from GroupIndex::hash) already
+        // worked out. Used by CompiledPath.
+        Setting *lkup(std::string_view name, uint64_t hash) {
             if (!is_group()) {
                 return nullptr;
             }
 
-            auto iter = group_.find(name);
-            if (iter == group_.end()) {
+            auto &c = kids();
+            int pos = c.group.find(name, hash);
+            if (pos < 0) {
                 return nullptr;
             }
 
-            return &(children_.at(iter->second));
+            return &(c.children[pos]);
         }
 
         Setting &at_path(std::string_view path) {
@@ -571,9 +925,9 @@ namespace simpleConfig {
                 }
             } else {
                 if (path.empty())  {
-                    return at(std::string(piece));
+                    return at(piece);
                 } else {
-                    return at(std::string(piece)).at_path(path);
+                    return at(piece).at_path(path);
                 }
             }
             throw std::runtime_error("How did we get here ?");
@@ -599,7 +953,7 @@ namespace simpleConfig {
                 int index = std::stol(std::string(piece.substr(1, piece.size()-2)));
                 retval = lkup(index);
             } else {
-                retval = lkup(std::string(piece));
+                retval = lkup(piece);
             }
 
             if (retval && not path.empty()) {
@@ -681,30 +1035,32 @@ namespace simpleConfig {
             return lkup(first_arg);
         }
 
-        auto begin() {
-            return children_.begin();
+        // Iterate over the children. Scalars have none.
+        Setting *begin() {
+            return is_composite() ? kids().children.data() : nullptr;
         }
 
-        auto end() {
-            return children_.end();
+        Setting *end() {
+            if (not is_composite()) return nullptr;
+            auto &children = kids().children;
+            return children.data() + children.size();
         }
 
-        std::ostream &stream_setting(std::ostream& strm,
-            const std::string prefix = "");
-
-    private :
-
-        void stream_scalar(std::ostream& strm,
-            const std::string prefix);
-
-        void stream_group(std::ostream& strm,
-            const std::string prefix);
+        const Setting *begin() const {
+            return is_composite() ? kids().children.data() : nullptr;
+        }
 
-        void stream_array(std::ostream& strm,
-            const std::string prefix);
+        const Setting *end() const {
+            if (not is_composite()) return nullptr;
+            auto &children = kids().children;
+            return children.data() + children.size();
+        }
 
-        void stream_list(std::ostream& strm,
-            const std::string prefix);
+        // Write the setting in config syntax, each line starting with
+        // `prefix` (see SettingWriter). The whole write is given a span in
+        // `trace`, if set.
+        std::ostream &stream_setting(std::ostream& strm,
+            std::string_view prefix = {}, TraceRecorder *trace = nullptr);
 
     };
 
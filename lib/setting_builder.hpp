@@ -0,0 +1,137 @@
+#pragma once
+
+#include "parse_handler.hpp"
+#include "setting.hpp"
+#include "parse_stats.hpp"
+
+#include <string>
+#include <vector>
+
+namespace simpleConfig {
+
+    // A ParseHandler that builds the Setting tree. This is what Parser
+    // uses; the events are attached below the Setting it is given. Each
+    // Setting made is given its source_offset().
+    struct SettingBuilder : public ParseHandler {
+
+        // When true, strings that live in the source text are stored
+        // as views rather than copied.
+        bool borrow_strings = false;
+
+        // Loads the groups the parser deferred.
+        GroupLoader *loader = nullptr;
+
+        // Where to count the settings made, if anywhere. Only used when
+        // built with SIMPLECONFIG_STATS.
+        parse_stats *stats = nullptr;
+
+        SettingBuilder(Setting *root) {
+            stack_.push_back(root);
+        }
+
+        Action key(std::string_view name) override {
+            pending_ = stack_.back()->try_add_child(name, ValType::NONE);
+            if (not pending_) {
+                return Action::REJECT;
+            }
+            pending_->set_source_offset(start);
+            return Action::CONTINUE;
+        }
+
+        Action begin_group() override {
+            return open(ValType::GROUP);
+        }
+
+        Action begin_array() override {
+            return open(ValType::ARRAY);
+        }
+
+        Action begin_list() override {
+            return open(ValType::LIST);
+        }
+
+        Action deferred_group(const parse_loc &body) override {
+            deferred_body d;
+            d.loader = loader;
+            d.text = body.sv;
+            d.line = body.line;
+            next(ValType::GROUP)->defer(d);
+            return Action::CONTINUE;
+        }
+
+        Action end_group() override { return close(); }
+        Action end_array() override { return close(); }
+        Action end_list() override { return close(); }
+
+        Action bool_value(bool v) override {
+            next(ValType::BOOL)->set_value(v);
+            return Action::CONTINUE;
+        }
+
+        Action integer_value(long v) override {
+            next(ValType::INTEGER)->set_value(v);
+            return Action::CONTINUE;
+        }
+
+        Action float_value(double v) override {
+            next(ValType::FLOAT)->set_value(v);
+            return Action::CONTINUE;
+        }
+
+        Action string_value(std::string_view v, bool in_source) override {
+            if (borrow_strings and in_source) {
+                next(ValType::STRING)->set_view(v);
+            } else {
+                SC_STAT(if (stats) stats->string_bytes_copied += v.size();)
+                next(ValType::STRING)->set_value(std::string(v));
+            }
+            return Action::CONTINUE;
+        }
+
+    protected :
+        // The group, array or list values are being added to.
+        Setting *top() const { return stack_.back(); }
+
+        // Where the next value goes. The parser has already made sure the
+        // value is allowed there (array element types match, etc.).
+        Setting *next(ValType t) {
+            SC_STAT(if (stats) stats->nodes[size_t(t)] += 1;)
+            if (pending_) {
+                auto *s = pending_;
+                pending_ = nullptr;
+                return s;
+            }
+            auto *s = stack_.back()->try_add_child(t);
+            s->set_source_offset(start);
+            return s;
+        }
+
+        Action open(ValType t) {
+            auto *s = next(t);
+            if (t == ValType::GROUP) {
+                s->make_group();
+            } else if (t == ValType::ARRAY) {
+                s->make_array();
+            } else {
+                s->make_list();
+            }
+            stack_.push_back(s);
+            SC_STAT(if (stats and int(stack_.size()) - 1 > stats->max_depth) {
+                stats->max_depth = int(stack_.size()) - 1;
+            })
+            return Action::CONTINUE;
+        }
+
+        Action close() {
+            stack_.pop_back();
+            return Action::CONTINUE;
+        }
+
+    private :
+        std::vector<Setting *> stack_;
+
+        // The child made for the last key() in a group.
+        Setting *pending_ = nullptr;
+    };
+
+}
@@ -0,0 +1,214 @@
+#include <setting_writer.hpp>
+
+#include <charconv>
+#include <cstdio>
+#include <locale>
+#include <ostream>
+
+namespace simpleConfig {
+
+    namespace {
+
+        const std::string_view spaces =
+            "                                                                "
+            "                                                                ";
+    }
+
+    SettingWriter::SettingWriter(std::ostream &strm, std::string_view prefix) :
+        strm_{strm}, prefix_{prefix}
+    {
+        using ios = std::ios_base;
+        auto flags = strm.flags();
+        auto base = flags & ios::basefield;
+        plain_ = (base == ios::dec or base == ios::fmtflags{})
+            and (flags & (ios::floatfield | ios::showpos | ios::showpoint
+                | ios::showbase | ios::uppercase)) == ios::fmtflags{}
+            and strm.getloc() == std::locale::classic();
+
+        buf_.reserve(block_size + block_size / 4);
+    }
+
+    SettingWriter::~SettingWriter() {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+    void SettingWriter::flush() {
+        if (not buf_.empty()) {
+            strm_.write(buf_.data(), std::streamsize(buf_.size()));
+            buf_.clear();
+        }
+        if (wrote_bool_) {
+            strm_ << std::boolalpha;
+        }
+    }
+
+    void SettingWriter::indent(int depth) {
+        put(prefix_);
+        auto n = size_t(depth) * 2;
+        while (n > spaces.size()) {
+            put(spaces);
+            n -= spaces.size();
+        }
+        put(spaces.substr(0, n));
+    }
+
+    void SettingWriter::write(Setting &s) {
+        if (s.is_scalar()) {
+            write_scalar(s);
+        } else if (s.is_group()) {
+            write_group(s, 0);
+        } else if (s.is_array()) {
+            write_array(s, 0);
+        } else if (s.is_list()) {
+            write_list(s, 0);
+        }
+    }
+
+    void SettingWriter::write_scalar(const Setting &s) {
+        char text[64];
+
+        switch (s.get_type()) {
+            case ValType::INTEGER : {
+                auto v = s.get<long>();
+                if (plain_) {
+                    auto res = std::to_chars(text, text + sizeof(text), v);
+                    put(std::string_view(text, size_t(res.ptr - text)));
+                } else {
+                    flush();
+                    strm_ << v;
+                }
+                break;
+            }
+            case ValType::FLOAT : {
+                auto v = s.get<double>();
+                // What the stream does with the default flags.
+                auto precision = strm_.precision() < 0 ? 6 : int(strm_.precision());
+                int n = plain_ ? std::snprintf(text, sizeof(text), "%.*g", precision, v) : -1;
+                if (n >= 0 and size_t(n) < sizeof(text)) {
+                    put(std::string_view(text, size_t(n)));
+                } else {
+                    flush();
+                    strm_ << v;
+                }
+                break;
+            }
+            case ValType::BOOL :
+                put(s.get<bool>() ? "true" : "false");
+                wrote_bool_ = true;
+                break;
+            case ValType::STRING :
+                put('"');
+                put(s.get<std::string_view>());
+                put('"');
+                break;
+            default :
+                break;
+        }
+    }
+
+    void SettingWriter::write_group(Setting &s, int depth) {
+        bool is_first = true;
+        for (const auto &[name, value] : s.entries()) {
+            if (is_first) {
+                is_first = false;
+            } else {
+                put(",\n");
+            }
+            indent(depth);
+            put(name);
+            put(" : ");
+            if (value.is_scalar()) {
+                write_scalar(value);
+            } else if (value.is_group()) {
+                put("{\n");
+                write_group(value, depth + 1);
+                indent(depth);
+                put('}');
+            } else if (value.is_array()) {
+                write_array(value, depth + 1);
+            } else if (value.is_list()) {
+                write_list(value, depth + 1);
+            }
+            maybe_flush();
+        }
+        if (not is_first) {
+            put('\n');
+        }
+    }
+
+    void SettingWriter::write_array(Setting &s, int depth) {
+        put('[');
+
+        char delim = ' ';
+        if (s.array_type() == ValType::GROUP) {
+            delim = '\n';
+        }
+        put(delim);
+
+        bool is_first = true;
+        for (auto &c : s) {
+            if (is_first) {
+                is_first = false;
+            } else {
+                put(',');
+                put(delim);
+            }
+            if (c.is_scalar()) {
+                write_scalar(c);
+            } else if (c.is_group()) {
+                indent(depth);
+                put("{\n");
+                write_group(c, depth + 1);
+                indent(depth);
+                put('}');
+            } else {
+                throw std::runtime_error("Array with bad element type");
+            }
+            maybe_flush();
+        }
+
+        put(" ]");
+    }
+
+    void SettingWriter::write_list(Setting &s, int depth) {
+        put('(');
+
+        bool is_first = true;
+        bool last_was_composite = false;
+        for (auto &c : s) {
+            if (is_first) {
+                is_first = false;
+            } else {
+                put(',');
+            }
+            if (c.is_scalar()) {
+                put(' ');
+                write_scalar(c);
+                last_was_composite = false;
+            } else if (c.is_group()) {
+                put('\n');
+                indent(depth);
+                put(" {\n");
+                write_group(c, depth + 1);
+                indent(depth);
+                put('}');
+                last_was_composite = true;
+            } else if (c.is_list()) {
+                write_list(c, depth + 1);
+                last_was_composite = true;
+            }
+            maybe_flush();
+        }
+        if (last_was_composite) {
+            put('\n');
+            indent(depth);
+            put(')');
+        } else {
+            put(" )");
+        }
+    }
+
+}
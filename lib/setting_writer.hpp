@@ -0,0 +1,65 @@
+#pragma once
+
+#include "setting.hpp"
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+namespace simpleConfig {
+
+    // Writes settings in config syntax, for Setting::stream_setting().
+    //
+    // The text is put together in a buffer of its own, which goes to the
+    // stream a block at a time, and indents come from a table of spaces,
+    // so the stream is only written to every block_size bytes or so.
+    // Numbers are formatted as the stream would format them : by hand when
+    // it has the default flags and the classic locale, and by the stream
+    // itself (after the buffer) otherwise. The stream's width is ignored.
+    class SettingWriter {
+    public :
+        static constexpr size_t block_size = 64 * 1024;
+
+        // Every line starts with `prefix`, which has to outlive the writer.
+        explicit SettingWriter(std::ostream &strm, std::string_view prefix = {});
+
+        // Flushes, unless the stream throws.
+        ~SettingWriter();
+
+        SettingWriter(const SettingWriter &) = delete;
+        SettingWriter &operator=(const SettingWriter &) = delete;
+
+        void write(Setting &s);
+
+        // Hand what is buffered to the stream.
+        void flush();
+
+    private :
+        std::ostream &strm_;
+        std::string buf_;
+        std::string_view prefix_;
+
+        // Numbers can be formatted here rather than by the stream.
+        bool plain_;
+
+        // The stream is left with boolalpha set once a bool is written,
+        // as it always has been.
+        bool wrote_bool_ = false;
+
+        void put(std::string_view s) { buf_.append(s); }
+        void put(char c) { buf_.push_back(c); }
+
+        // The prefix and `depth` levels of indent.
+        void indent(int depth);
+
+        void maybe_flush() {
+            if (buf_.size() >= block_size) flush();
+        }
+
+        void write_scalar(const Setting &s);
+        void write_group(Setting &s, int depth);
+        void write_array(Setting &s, int depth);
+        void write_list(Setting &s, int depth);
+    };
+
+}
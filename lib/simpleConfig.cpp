@@ -2,54 +2,386 @@
 #include <schema_parser.hpp>
 #include <config_parser.hpp>
 #include "validator.hpp"
+#include "snapshot.hpp"
+#include "parallel.hpp"
+#include "schema_program.hpp"
+#include "validating_builder.hpp"
+#include "parallel_validator.hpp"
 
 #include <simpleConfig.hpp>
 
 #include <set>
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+#include <random>
+#include <algorithm>
+#include <chrono>
 
 #include <iostream>
 
 namespace simpleConfig {
 
+    namespace {
+
+        // Where the body of a deferred group starts, for the parser.
+        parse_loc body_loc(std::string_view source, const deferred_body &body) {
+            return {body.text, int(body.text.data() - source.data()), body.line};
+        }
+
+#if defined(SIMPLECONFIG_STATS)
+        using stats_clock = std::chrono::steady_clock;
+
+        double seconds_since(stats_clock::time_point start) {
+            return std::chrono::duration<double>(stats_clock::now() - start).count();
+        }
+
+        // Adds the counts of parsing a deferred group's body, which start
+        // `depth` levels down, to those of the parse that skipped it. That
+        // parse already counted the text.
+        void add_body_stats(parse_stats &to, parse_stats body, int depth) {
+            body.config_bytes = 0;
+            body.max_depth += depth;
+            to.merge(body);
+        }
+
+        // Counts the calls to allocate() for Config::stats().
+        class counting_resource : public std::pmr::memory_resource {
+            std::pmr::memory_resource *upstream_;
+            std::atomic<size_t> &count_;
+
+            void *do_allocate(size_t bytes, size_t align) override {
+                count_.fetch_add(1, std::memory_order_relaxed);
+                return upstream_->allocate(bytes, align);
+            }
+
+            void do_deallocate(void *p, size_t bytes, size_t align) override {
+                upstream_->deallocate(p, bytes, align);
+            }
+
+            bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override {
+                return this == &o;
+            }
+
+        public :
+            counting_resource(std::pmr::memory_resource *upstream, std::atomic<size_t> &count) :
+                upstream_{upstream}, count_{count} {}
+        };
+#endif
+
+        // Lets several threads allocate from the one arena.
+        class locked_resource : public std::pmr::memory_resource {
+            std::pmr::memory_resource *upstream_;
+            std::mutex lock_;
+
+            void *do_allocate(size_t bytes, size_t align) override {
+                std::lock_guard<std::mutex> guard{lock_};
+                return upstream_->allocate(bytes, align);
+            }
+
+            void do_deallocate(void *p, size_t bytes, size_t align) override {
+                std::lock_guard<std::mutex> guard{lock_};
+                upstream_->deallocate(p, bytes, align);
+            }
+
+            bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override {
+                return this == &o;
+            }
+
+        public :
+            explicit locked_resource(std::pmr::memory_resource *upstream) :
+                upstream_{upstream} {}
+        };
+
+        // Parses the groups that a lazy parse deferred, and checks them
+        // against the schema when that was put off as well.
+        class lazy_loader : public GroupLoader {
+            std::string_view source_;
+            error_list &errors_;
+            bool borrow_strings_;
+            LineIndex lines_;
+
+            // Deferred groups point into its tree, so it has to stay
+            // around even if the Config is given another schema.
+            std::shared_ptr<const Schema> schema_;
+
+        public :
+            // Loads are counted here, if set. The deferred groups are
+            // this many levels down.
+            parse_stats *stats = nullptr;
+            int depth = 0;
+
+            // Each load is given a span here, if set.
+            TraceRecorder *trace = nullptr;
+
+            lazy_loader(std::string_view source, error_list &errors, bool borrow_strings,
+                    std::shared_ptr<const Schema> schema = nullptr) :
+                source_{source}, errors_{errors}, borrow_strings_{borrow_strings},
+                lines_{source}, schema_{std::move(schema)} {}
+
+            void load(Setting &group, const deferred_body &body) override {
+                trace_span span{trace, "load group", "parse"};
+                SC_STAT(parse_stats counted;)
+                SC_STAT(auto started = stats_clock::now();)
+                Parser parser{source_, &group, errors_};
+                parser.borrow_strings = borrow_strings_;
+                SC_STAT(if (stats) parser.stats = &counted;)
+                bool ok = parser.do_parse_body(body_loc(source_, body));
+                SC_STAT(if (stats) {
+                    counted.parse_seconds = seconds_since(started);
+                    add_body_stats(*stats, counted, depth);
+                })
+                if (not ok) {
+                    return;
+                }
+
+                if (body.schema) {
+                    SC_STAT(started = stats_clock::now();)
+                    auto validator = Validator(errors_);
+                    validator.lines = &lines_;
+                    validator.stats = stats;
+                    validator.trace = trace;
+                    validator.validate_group(&group, body.schema);
+                    SC_STAT(if (stats) stats->validate_seconds += seconds_since(started);)
+                }
+            }
+        };
+    }
+
     bool Config::set_schema(std::string schema) {
-        if (schema_tree_) delete schema_tree_;
-        schema_tree_ = new SchemaNode();
-        if (schema_parser_) delete schema_parser_;
-        schema_parser_ = new SchemaParser(schema, schema_tree_, errors);
+        parse_stats *counted = nullptr;
+        SC_STAT(if (collect_stats_) counted = &stats_;)
+        SC_STAT(auto started = stats_clock::now();)
+        trace_span span{trace_, "set_schema", "schema"};
+        schema_ = Schema::parse(schema, errors, counted);
+        SC_STAT(if (counted) counted->schema_seconds += seconds_since(started);)
+        return schema_ != nullptr;
+    }
 
-        auto parse_ok = schema_parser_->do_parse();
 
-        if (not parse_ok) {
-            delete schema_tree_;
-            schema_tree_ = nullptr;
+
+    bool Config::parse_file(std::string file_name) {
+        std::string error;
+        if (not source_.load(file_name, error)) {
+            reset_tree(0, use_arena_);
+            errors.add(error, parse_loc{}, "Config"s);
+            return false;
         }
 
-        return parse_ok;
+        std::string cache_file;
+        if (not cache_dir_.empty()) {
+            cache_file = cache_file_for(source_.text());
+            if (restore_snapshot(cached_, cache_file, error)) {
+                cache_hit_ = true;
+                source_.release();
+                return true;
+            }
+            // Not there (or damaged) : parse as usual.
+        }
+
+        auto ok = parse_with_schema(source_.text());
+
+        // Writing the snapshot would load all of a lazy tree.
+        if (ok and not cache_file.empty() and lazy_level_ == 0) {
+            write_cache(cache_file);
+        }
+
+        if (not keeps_source()) {
+            source_.release();
+        }
+
+        return ok;
+    }
+
+    std::string Config::cache_file_for(std::string_view text) const {
+        uint64_t key = snapshot::checksum(text);
+        key = (key ^ (schema_ ? schema_->hash() : 0)) * 0x100000001b3ull;
+        key ^= snapshot::version;
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "%016llx-%llx.snap",
+            static_cast<unsigned long long>(key),
+            static_cast<unsigned long long>(text.size()));
+        return cache_dir_ + "/" + name;
+    }
+
+    void Config::write_cache(const std::string &file_name) {
+        auto image = snapshot::write(*cfg_);
+
+        // Other processes may be reading or writing the same entry, so
+        // write it under a private name and rename it into place.
+        auto tmp_name = file_name + ".tmp" + std::to_string(std::random_device{}());
+        {
+            std::ofstream strm{tmp_name, std::ios_base::binary | std::ios_base::trunc};
+            strm.write(image.data(), std::streamsize(image.size()));
+            strm.close();
+            if (not strm) {
+                std::remove(tmp_name.c_str());
+                return;
+            }
+        }
+        if (std::rename(tmp_name.c_str(), file_name.c_str()) != 0) {
+            std::remove(tmp_name.c_str());
+        }
     }
 
+    void Config::reset_tree(size_t size_hint, bool in_arena) {
+        // The old tree may live in the old arena, so it goes first.
+        cfg_.reset();
+        counter_.reset();
+        arena_lock_.reset();
+        arena_.reset();
+        loader_.reset();
+
+        // Where the tree allocates from. Null is the default resource.
+        std::pmr::memory_resource *res = nullptr;
+        if (in_arena) {
+            arena_ = std::make_unique<std::pmr::monotonic_buffer_resource>(
+                    std::max(size_hint, size_t(4096)));
+            res = arena_.get();
+            if (threads_ > 1) {
+                arena_lock_ = std::make_unique<locked_resource>(res);
+                res = arena_lock_.get();
+            }
+        }
+        SC_STAT(if (collect_stats_) {
+            counter_ = std::make_unique<counting_resource>(
+                res ? res : std::pmr::get_default_resource(), allocations_);
+            res = counter_.get();
+        })
+
+        if (in_arena) {
+            void *mem = res->allocate(sizeof(Setting), alignof(Setting));
+            auto *root = new (mem) Setting(VT::GROUP, Setting::allocator_type{res});
+            cfg_ = decltype(cfg_)(root, tree_deleter{true});
+        } else if (res) {
+            cfg_ = decltype(cfg_)(new Setting(VT::GROUP, Setting::allocator_type{res}),
+                tree_deleter{false});
+        } else {
+            cfg_ = decltype(cfg_)(new Setting(VT::GROUP), tree_deleter{false});
+        }
+    }
 
+    bool Config::save_snapshot(const std::string &file_name) {
+        if (has_errors()) {
+            errors.add("Not writing a snapshot of a config with errors"s, parse_loc{}, "Config"s);
+            return false;
+        }
 
-    bool Config::parse_with_schema(const std::string &input){
+        auto image = snapshot::write(*cfg_);
 
-        cfg_.reset(new Setting(VT::GROUP));
+        std::ofstream strm{file_name, std::ios_base::binary | std::ios_base::trunc};
+        strm.write(image.data(), std::streamsize(image.size()));
+        strm.close();
+        if (not strm) {
+            errors.add("Could not write snapshot "s + file_name, parse_loc{}, "Config"s);
+            return false;
+        }
+        return true;
+    }
+
+    bool Config::load_snapshot(const std::string &file_name) {
+        std::string error;
+        if (not restore_snapshot(source_, file_name, error)) {
+            errors.add(error, parse_loc{}, "Config"s);
+            return false;
+        }
+        return true;
+    }
+
+    bool Config::restore_snapshot(SourceBuffer &buf,
+            const std::string &file_name, std::string &error) {
+
+        cache_hit_ = false;
+        if (not buf.load(file_name, error)) {
+            reset_tree(0, use_arena_);
+            return false;
+        }
+
+        // Every node comes from the arena; strings stay in the file.
+        reset_tree(buf.size(), true);
+        if (&buf != &cached_) {
+            cached_.reset();
+        }
+        if (not snapshot::read(buf.text(), *cfg_, error)) {
+            reset_tree(0, use_arena_);
+            buf.reset();
+            error += " in "s + file_name;
+            return false;
+        }
+        return true;
+    }
+
+    bool Config::scan(std::string_view input, ParseHandler &handler) {
+        EventParser parser{input, &handler, errors};
+        return parser.do_parse();
+    }
+
+    bool Config::scan_file(const std::string &file_name, ParseHandler &handler) {
+        SourceBuffer buffer;
+        std::string error;
+        if (not buffer.load(file_name, error)) {
+            errors.add(error, parse_loc{}, "Config"s);
+            return false;
+        }
+
+        return scan(buffer.text(), handler);
+    }
+
+    bool Config::parse_with_schema(std::string_view input){
+
+        reset_tree(input.size(), use_arena_);
+        cached_.reset();
+        cache_hit_ = false;
 
         //std::cout << "Parsing : " << input << "\n";
 
-        if (parser_) delete parser_;
-        parser_ = new Parser(input, cfg_.get(), errors);
+        SC_STAT(auto started = stats_clock::now();)
+
+        if (single_pass_ and schema_ and lazy_level_ == 0) {
+            bool ok = parse_single_pass(input);
+            SC_STAT(if (collect_stats_) stats_.parse_seconds += seconds_since(started);)
+            return ok;
+        }
 
-        auto parse_ok = parser_->do_parse();
+        bool parse_ok = (threads_ > 1 and lazy_level_ == 0 and parse_parallel(input));
+
+        if (not parse_ok) {
+            // Either serial, or the parallel parse failed and we want its
+            // errors just as a serial parse reports them.
+            if (threads_ > 1 and lazy_level_ == 0) {
+                reset_tree(input.size(), use_arena_);
+            }
+
+            if (parser_) delete parser_;
+            parser_ = new Parser(input, cfg_.get(), errors);
+            parser_->borrow_strings = zero_copy_;
+            parser_->trace = trace_;
+            SC_STAT(if (collect_stats_) parser_->stats = &stats_;)
+            if (lazy_level_ > 0) {
+                auto loader = std::make_unique<lazy_loader>(input, errors, zero_copy_, schema_);
+                loader->trace = trace_;
+                SC_STAT(if (collect_stats_) {
+                    loader->stats = &stats_;
+                    loader->depth = lazy_level_;
+                })
+                loader_ = std::move(loader);
+                parser_->defer_level = lazy_level_;
+                parser_->builder.loader = loader_.get();
+            }
+
+            parse_ok = parser_->do_parse();
+        }
+        SC_STAT(if (collect_stats_) stats_.parse_seconds += seconds_since(started);)
 
         //if (! parse_ok) {
             //std::cout << "--- CONFIG PARSE FAILED ---\n";
             //stream_errors(std::cout);
         //}
 
-        //std::cout << "schema_tree = " << schema_tree_ << "\n";
-
-        if (parse_ok && schema_tree_) {
+        if (parse_ok && schema_) {
             //std::cout << "-- Okay to validate\n";
-            return check_against_schema();
+            return check_against_schema(input);
         }
 
         return parse_ok;
@@ -57,18 +389,117 @@ namespace simpleConfig {
 
 
 
-    bool Config::check_against_schema() {
-        // double check;
-        //if (! cfg_ || ! schema_tree_ ) return true;
+    bool Config::parse_parallel(std::string_view input) {
+        trace_span span{trace_, "parse", "parse"};
+
+        // Errors only tell us to fall back, so they go nowhere.
+        error_list scratch;
+
+        // Find the top level groups. The loader is never called; it is
+        // there so that the groups count as deferred.
+        lazy_loader unused{input, scratch, zero_copy_};
+        Parser prepass{input, cfg_.get(), scratch};
+        prepass.borrow_strings = zero_copy_;
+        prepass.defer_level = 1;
+        prepass.builder.loader = &unused;
+        // Only added to stats_ if it all works; otherwise the serial
+        // parse that follows counts the text.
+        SC_STAT(parse_stats counted;)
+        SC_STAT(if (collect_stats_) prepass.stats = &counted;)
+        {
+            trace_span find{trace_, "find groups", "parse"};
+            if (not prepass.do_parse()) {
+                return false;
+            }
+        }
 
-        auto validator = Validator(errors);
+        std::vector<Setting *> sections;
+        std::vector<std::string_view> names;
+        for (const auto &[name, s] : cfg_->entries(Setting::KeyOrder::INSERTION)) {
+            if (s.is_deferred()) {
+                sections.push_back(&s);
+                if (trace_) names.push_back(name);
+            }
+        }
 
-        return validator.validate(cfg_.get(), schema_tree_ );
+        // Each group is filled in by one task, in place, so the tasks
+        // share nothing but the allocator.
+        std::atomic<bool> failed{false};
+        SC_STAT(std::vector<parse_stats> section_stats(collect_stats_ ? sections.size() : 0);)
+        parallel_for(sections.size(), threads_, [&](size_t i) {
+            if (failed.load(std::memory_order_relaxed)) return;
+
+            trace_span group{trace_, "parse group", "parse", trace_ ? names[i] : ""sv};
+            error_list errs;
+            auto body = sections[i]->take_deferred();
+            Parser parser{input, sections[i], errs};
+            parser.borrow_strings = zero_copy_;
+            SC_STAT(if (collect_stats_) parser.stats = &section_stats[i];)
+            try {
+                if (not parser.do_parse_body(body_loc(input, body))) {
+                    failed = true;
+                }
+            } catch (...) {
+                failed = true;
+            }
+        });
+
+        SC_STAT(if (collect_stats_ and not failed) {
+            for (auto &s : section_stats) {
+                add_body_stats(counted, s, 1);
+            }
+            stats_.merge(counted);
+        })
+        return not failed;
+    }
+
+    bool Config::parse_single_pass(std::string_view input) {
+        ValidatingBuilder builder{cfg_.get(), schema_->program(), errors};
+        builder.borrow_strings = zero_copy_;
+
+        EventParser parser{input, &builder, errors};
+        parser.trace = trace_;
+        SC_STAT(if (collect_stats_) {
+            builder.stats = &stats_;
+            parser.stats = &stats_;
+        })
+        if (not parser.do_parse() or builder.failed()) {
+            return false;
+        }
+        return builder.finish();
+    }
+
+    bool Config::check_against_schema(std::string_view input) {
+        // Only looked at if there are errors.
+        LineIndex lines{input};
+        parse_stats *counted = nullptr;
+        SC_STAT(if (collect_stats_) counted = &stats_;)
+        SC_STAT(auto started = stats_clock::now();)
+        trace_span span{trace_, "validate", "validate"};
+
+        bool ok;
+        if (threads_ > 1 and lazy_level_ == 0) {
+            auto validator = ParallelValidator(schema_->program(), errors, threads_);
+            validator.lines = &lines;
+            validator.stats = counted;
+            validator.trace = trace_;
+            ok = validator.validate(cfg_.get());
+        } else {
+            auto validator = ProgramValidator(schema_->program(), errors);
+            validator.leave_deferred = (lazy_check_ == LazyCheck::ON_TOUCH);
+            validator.lines = &lines;
+            validator.stats = counted;
+            validator.trace = trace_;
+            ok = validator.validate(cfg_.get());
+        }
+
+        SC_STAT(if (counted) counted->validate_seconds += seconds_since(started);)
+        return ok;
 
     }
 
     std::ostream &Config::stream_errors(std::ostream &strm) {
-        strm << parser_->errors;
+        strm << errors;
 
         return strm;
     }
@@ -78,16 +509,6 @@ namespace simpleConfig {
             delete parser_;
             parser_ = nullptr;
         }
-
-        if (schema_tree_) {
-            delete schema_tree_;
-            schema_tree_ = nullptr;
-        }
-
-        if (schema_parser_) {
-            delete schema_parser_;
-            schema_parser_ = nullptr;
-        }
     }
 
 } // end namespace simpleConfig
@@ -5,44 +5,96 @@
 #include "value_type.hpp"
 #include "parser_utils.hpp"
 #include "setting.hpp"
+#include "compiled_path.hpp"
+#include "source_buffer.hpp"
+#include "parse_handler.hpp"
+#include "schema.hpp"
+#include "parse_stats.hpp"
+#include "trace_recorder.hpp"
 
 #include <memory>
+#include <memory_resource>
 #include <sstream>
 #include <fstream>
 #include <functional>
+#include <atomic>
 
 #include <type_traits>
 
 using namespace std::literals::string_literals;
 
 namespace simpleConfig {
-    
-    // These make up the schema tree
-    // that is consulted for the rules
-    struct SchemaNode;
-
 
     struct Parser;
-    struct SchemaParser;
+
+    // Deletes the Setting tree owned by a Config. In arena mode the whole
+    // tree lives in the Config's arena and is thrown away with it rather
+    // than being destroyed node by node.
+    struct tree_deleter {
+        bool in_arena = false;
+        void operator()(Setting *s) const {
+            if (not in_arena) delete s;
+        }
+    };
 
     class Config {
-        std::unique_ptr<Setting>cfg_;
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
+        bool use_arena_ = false;
+
+        // Counts the tree's allocations into allocations_ when stats are
+        // collected. Before cfg_, so that it outlives the tree.
+        std::unique_ptr<std::pmr::memory_resource> counter_;
+        std::atomic<size_t> allocations_{0};
+
+        parse_stats stats_;
+        bool collect_stats_ = false;
+
+        TraceRecorder *trace_ = nullptr;
+
+        std::unique_ptr<Setting, tree_deleter>cfg_;
 
         // can't use unique_ptr with incomplete types.
         Parser* parser_ = nullptr;
-        SchemaParser* schema_parser_ = nullptr;
-        SchemaNode* schema_tree_ = nullptr;
+
+        std::shared_ptr<const Schema> schema_;
 
         error_list errors;
 
+        // The text of the last parse, when the Config owns it.
+        // In zero copy mode, string settings refer into it.
+        SourceBuffer source_;
+        bool zero_copy_ = false;
+
+        // The parse cache. cached_ holds the snapshot the settings were
+        // restored from on a hit.
+        std::string cache_dir_;
+        SourceBuffer cached_;
+        bool cache_hit_ = false;
+
     public :
+        // When a lazy parse checks the deferred groups against the schema.
+        enum class LazyCheck { EAGER, ON_TOUCH };
+
+    private :
+        // Lazy parsing. loader_ fills in the deferred groups of the
+        // current tree.
+        int lazy_level_ = 0;
+        LazyCheck lazy_check_ = LazyCheck::EAGER;
+        std::unique_ptr<GroupLoader> loader_;
+
+        // Parallel parsing. arena_lock_ lets the parse threads share the
+        // arena.
+        unsigned threads_ = 1;
+        std::unique_ptr<std::pmr::memory_resource> arena_lock_;
+
+        bool single_pass_ = false;
+
+    public :
+
+        // Regular files are memory mapped and parsed in place.
+        bool parse_file(std::string file_name);
 
-        bool parse_file(std::string file_name) {
-            std::ifstream strm{file_name, std::ios_base::binary};
-            return parse(strm);
-        }
         bool parse(std::ifstream &strm) {
-            // too many copies, but shouldn't matter much.
             std::stringstream buffer;
             buffer << strm.rdbuf();
             return parse(buffer.str());
@@ -50,10 +102,163 @@ namespace simpleConfig {
 
         bool set_schema(std::string schema_text);
 
+        // Use a Schema that has already been parsed, shared with whoever
+        // else holds it. Null means no schema.
+        void set_schema(std::shared_ptr<const Schema> schema) { schema_ = std::move(schema); }
+
+        void set_schema(std::nullptr_t) { schema_.reset(); }
+
+        const std::shared_ptr<const Schema> &schema() const { return schema_; }
+
         bool parse(const std::string &input) {
+            if (keeps_source()) {
+                source_.assign(std::string(input));
+                return parse_with_schema(source_.text());
+            }
+            source_.reset();
+            return parse_with_schema(input);
+        }
+
+        bool parse(std::string &&input) {
+            if (keeps_source()) {
+                source_.assign(std::move(input));
+                return parse_with_schema(source_.text());
+            }
+            source_.reset();
             return parse_with_schema(input);
         }
 
+        // When on, the Config keeps its own copy of the text being parsed
+        // and string settings without escapes refer into it rather than
+        // holding a copy. Use get<std::string_view>() to read them
+        // without copying. Such settings are only valid while the Config
+        // lives and until the next parse; copies of them hold their own
+        // text.
+        void set_zero_copy(bool on) { zero_copy_ = on; }
+
+        bool zero_copy() const { return zero_copy_; }
+
+        // When `level` is more than 0, the groups that are the values of
+        // settings on that level (1 is the top) are not parsed right away.
+        // The parser only finds where each one ends, and the group is
+        // parsed the first time anything asks for its children : at(),
+        // lkup(), count(), iteration and so on. The Config keeps the text
+        // until the next parse, as in zero copy mode.
+        //
+        // Syntax errors in a deferred group are only found when it is
+        // loaded. They are added to get_errors() then, and the group keeps
+        // whatever was parsed before the error. With a schema, EAGER
+        // checks the whole config during parse(), which loads every
+        // group; ON_TOUCH checks each deferred group when it is loaded.
+        //
+        // Loading changes the tree, so a lazy tree should not be read from
+        // several threads at once until everything in it is loaded.
+        // parse_file() reads from the parse cache as usual, but only adds
+        // to it when the parse isn't lazy.
+        void set_lazy(int level, LazyCheck check = LazyCheck::EAGER) {
+            lazy_level_ = level;
+            lazy_check_ = check;
+        }
+
+        int lazy_level() const { return lazy_level_; }
+
+        // Parse with up to `n` threads. A quick pass over the text finds
+        // where each top level group starts and ends (and parses
+        // everything else on the top level), then the groups are parsed
+        // at the same time. If that pass or any group has an error, the
+        // config is parsed again on one thread, so the errors are exactly
+        // those of a serial parse. The schema check is shared out the
+        // same way (see ParallelValidator), again with the same results.
+        // 0 or 1 (the default) parses on the calling thread only. Not
+        // used by lazy parses. In arena mode the arena is shared through a
+        // lock.
+        void set_threads(unsigned n) { threads_ = n; }
+
+        unsigned threads() const { return threads_; }
+
+        // When on, and there is a schema, the config is checked while it
+        // is parsed rather than after : unknown keys and wrong types are
+        // caught as they are read, ranges and enums as each value is
+        // added, and defaults are filled in as each group closes. The
+        // parse stops at the first error, so only that error is reported
+        // (with its line), and the settings are left part built. Without
+        // errors the result is the same as a regular parse. Not used by
+        // lazy parses, and it always runs on the calling thread.
+        void set_single_pass(bool on) { single_pass_ = on; }
+
+        bool single_pass() const { return single_pass_; }
+
+        // When on, set_schema(text), parses and schema checks add what they
+        // did to stats() : bytes read, settings made by type and how deep
+        // they go, allocations for the tree, string bytes copied, escapes
+        // decoded, defaults added and the time each step took. Only when
+        // the library is built with SIMPLECONFIG_STATS (the SC_STATS CMake
+        // option); otherwise the counting isn't compiled in at all and
+        // stats() stays empty. Parse cache hits and snapshots aren't
+        // counted.
+        void set_stats(bool on) { collect_stats_ = on; }
+
+        bool collecting_stats() const { return collect_stats_; }
+
+        // The counts since the last clear_stats(). parse_stats can write
+        // itself as JSON with write_json().
+        parse_stats stats() const {
+            auto s = stats_;
+            s.allocations += allocations_.load(std::memory_order_relaxed);
+            return s;
+        }
+
+        void clear_stats() {
+            stats_.clear();
+            allocations_ = 0;
+        }
+
+        // When set, set_schema(text), parses and schema checks record
+        // spans in `rec` : the whole of each step, each top level group
+        // parsed, and the checks of large groups and arrays (see
+        // TraceRecorder::min_children). Write them out with
+        // rec->write_json(). The recorder must outlive the Config, or be
+        // unset first.
+        void set_trace(TraceRecorder *rec) { trace_ = rec; }
+
+        TraceRecorder *trace() const { return trace_; }
+
+        // When on, each parse allocates the whole Setting tree (nodes,
+        // keys and strings) from one monotonic arena owned by the Config.
+        // The tree is freed in one go when the Config is reparsed or
+        // destroyed. Settings copied out of the tree use the default
+        // allocator as usual.
+        void set_arena(bool on) { use_arena_ = on; }
+
+        bool arena() const { return use_arena_; }
+
+        // Write the settings to `file_name` as a binary snapshot that
+        // load_snapshot() can read back without parsing. Meant to be run
+        // once parse() (and validation) succeeded; refuses if there are
+        // errors.
+        bool save_snapshot(const std::string &file_name);
+
+        // Replace the settings with those in a snapshot file. The file is
+        // mapped and the tree is built in an arena, with strings referring
+        // into the file. The version and checksum are checked, but the
+        // schema is not consulted.
+        bool load_snapshot(const std::string &file_name);
+
+        // Cache the results of parse_file() in the directory `dir`, which
+        // must exist. Entries are named by a hash of the file's contents
+        // and of the schema text. On a hit the validated settings are
+        // restored as by load_snapshot() and neither the parser nor the
+        // validator runs. Entries are only written for files that parse
+        // and validate cleanly. An empty `dir` turns the cache off.
+        //
+        // A restored tree is in an arena, and its strings refer into the
+        // mapped entry, as in zero copy mode : they are only valid while
+        // the Config lives and until the next parse. Copies of them hold
+        // their own text.
+        void set_cache_dir(std::string dir) { cache_dir_ = std::move(dir); }
+
+        const std::string &cache_dir() const { return cache_dir_; }
+
         Setting& get_settings() const {
             return *cfg_;
         }
@@ -101,6 +306,37 @@ namespace simpleConfig {
             return get_settings().lkup_tpath(args...);
         }
 
+        Setting& at(const CompiledPath &path) {
+            return path.at(get_settings());
+        }
+
+        Setting* lkup(const CompiledPath &path) {
+            return path.lkup(get_settings());
+        }
+
+        template<typename T> T get(const CompiledPath &path) {
+            return path.get<T>(get_settings());
+        }
+
+        template<typename T> T get(const CompiledPath &path, T fallback) {
+            return path.get<T>(get_settings(), fallback);
+        }
+
+        // Run the parser over the input, sending the events to `handler`
+        // rather than building a Setting tree. The schema (if any) is not
+        // consulted. Errors are reported as for parse().
+        bool scan(std::string_view input, ParseHandler &handler);
+
+        bool scan_file(const std::string &file_name, ParseHandler &handler);
+
+        // How many bytes the last parse_file() mapped or read, and whether
+        // the settings came from the parse cache.
+        input_stats last_input() const {
+            auto stats = source_.stats();
+            stats.cached = cache_hit_;
+            return stats;
+        }
+
         bool has_errors() const {return (errors.count() > 0); }
 
         const error_list &get_errors() const { return errors; }
@@ -110,9 +346,34 @@ namespace simpleConfig {
         ~Config();
 
     private:
-        bool parse_with_schema(const std::string &input);
+        // The Config holds on to the text of a parse when settings may
+        // still refer to it.
+        bool keeps_source() const { return zero_copy_ or lazy_level_ > 0; }
+
+        // Throw away the current tree and start a new, empty one.
+        void reset_tree(size_t size_hint, bool in_arena);
+
+        // Map the snapshot `file_name` into `buf` and build the tree from
+        // it. Errors go into `error` rather than the error list.
+        bool restore_snapshot(SourceBuffer &buf, const std::string &file_name,
+                std::string &error);
+
+        // Where the parse cache keeps the result of parsing `text`.
+        std::string cache_file_for(std::string_view text) const;
+
+        // Best effort; failures are ignored.
+        void write_cache(const std::string &file_name);
+
+        bool parse_with_schema(std::string_view input);
+
+        // Parse into the (empty) tree using threads_ threads. Returns
+        // false, with nothing in the error list, if there is any error.
+        bool parse_parallel(std::string_view input);
+        bool parse_single_pass(std::string_view input);
 
-        bool check_against_schema();
+        // `input` is the text the tree was parsed from, for the lines of
+        // errors.
+        bool check_against_schema(std::string_view input);
     };
 
 
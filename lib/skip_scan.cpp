@@ -0,0 +1,354 @@
+#include <skip_scan.hpp>
+
+#include <cstdint>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define SC_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(SC_HAVE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define SC_HAVE_AVX2 1
+#include <immintrin.h>
+#define SC_TARGET_AVX2 __attribute__((target("avx2,popcnt,bmi")))
+#endif
+
+namespace simpleConfig::skip_scan {
+
+    namespace {
+
+        inline bool is_blank(char c) {
+            // same set as std::isspace in the "C" locale
+            return c == ' ' or (c >= '\t' and c <= '\r');
+        }
+
+        inline int popcount(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_popcount(x);
+#else
+            int c = 0;
+            while (x) { x &= x - 1; ++c; }
+            return c;
+#endif
+        }
+
+        inline int lowest_bit(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctz(x);
+#else
+            int i = 0;
+            while (!(x & 1u)) { x >>= 1; ++i; }
+            return i;
+#endif
+        }
+
+        //
+        // Count the line breaks in the bytes selected by `below`.
+        // `prev_ff` says whether the byte before bit 0 was a '\f'
+        // (so a '\n' in bit 0 is the second half of a pair).
+        //
+        inline int count_lines(uint32_t nl, uint32_t ff, uint32_t below,
+                bool prev_ff) {
+            uint32_t after_ff = (ff << 1) | (prev_ff ? 1u : 0u);
+            return popcount(ff & below) + popcount(nl & ~after_ff & below);
+        }
+
+        /*==================== scalar ====================*/
+
+        size_t blanks_tail(const char *p, size_t i, size_t n, int &lines,
+                bool prev_ff) {
+            for (; i < n; ++i) {
+                char c = p[i];
+                if (c == '\n') {
+                    if (not prev_ff) lines += 1;
+                } else if (c == '\f') {
+                    lines += 1;
+                } else if (not is_blank(c)) {
+                    break;
+                }
+                prev_ff = (c == '\f');
+            }
+            return i;
+        }
+
+        size_t line_end_tail(const char *p, size_t i, size_t n) {
+            for (; i < n; ++i) {
+                if (p[i] == '\n' or p[i] == '\f') break;
+            }
+            return i;
+        }
+
+        size_t block_stop_tail(const char *p, size_t i, size_t n, int &lines,
+                bool prev_ff) {
+            for (; i < n; ++i) {
+                char c = p[i];
+                if (c == '*') {
+                    break;
+                } else if (c == '\n') {
+                    if (not prev_ff) lines += 1;
+                } else if (c == '\f') {
+                    lines += 1;
+                }
+                prev_ff = (c == '\f');
+            }
+            return i;
+        }
+
+        size_t blanks_scalar(const char *p, size_t n, int &lines) {
+            return blanks_tail(p, 0, n, lines, false);
+        }
+
+        size_t line_end_scalar(const char *p, size_t n) {
+            return line_end_tail(p, 0, n);
+        }
+
+        size_t block_stop_scalar(const char *p, size_t n, int &lines) {
+            return block_stop_tail(p, 0, n, lines, false);
+        }
+
+        /*==================== SSE2 ====================*/
+#if SC_HAVE_SSE2
+
+        struct sse2_masks {
+            uint32_t nl, ff;
+        };
+
+        inline sse2_masks sse2_breaks(__m128i v) {
+            return {
+                uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')))),
+                uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\f'))))
+            };
+        }
+
+        size_t blanks_sse2(const char *p, size_t n, int &lines) {
+            size_t i = 0;
+            bool prev_ff = false;
+
+            const __m128i nine = _mm_set1_epi8('\t');
+            const __m128i four = _mm_set1_epi8('\r' - '\t');
+            const __m128i space = _mm_set1_epi8(' ');
+
+            for (; i + 16 <= n; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                // '\t' .. '\r' : (c - '\t') <= 4 when treated as unsigned
+                __m128i d = _mm_sub_epi8(v, nine);
+                __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(d, four), d);
+                __m128i ws = _mm_or_si128(ctl, _mm_cmpeq_epi8(v, space));
+                uint32_t other = ~uint32_t(_mm_movemask_epi8(ws)) & 0xFFFFu;
+                auto m = sse2_breaks(v);
+
+                if (other) {
+                    int k = lowest_bit(other);
+                    lines += count_lines(m.nl, m.ff, (1u << k) - 1, prev_ff);
+                    return i + k;
+                }
+                lines += count_lines(m.nl, m.ff, 0xFFFFu, prev_ff);
+                prev_ff = (m.ff >> 15) & 1u;
+            }
+
+            return blanks_tail(p, i, n, lines, prev_ff);
+        }
+
+        size_t line_end_sse2(const char *p, size_t n) {
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                auto m = sse2_breaks(v);
+                if (m.nl | m.ff) {
+                    return i + lowest_bit(m.nl | m.ff);
+                }
+            }
+            return line_end_tail(p, i, n);
+        }
+
+        size_t block_stop_sse2(const char *p, size_t n, int &lines) {
+            size_t i = 0;
+            bool prev_ff = false;
+            const __m128i star = _mm_set1_epi8('*');
+
+            for (; i + 16 <= n; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+                uint32_t stars = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, star)));
+                auto m = sse2_breaks(v);
+
+                if (stars) {
+                    int k = lowest_bit(stars);
+                    lines += count_lines(m.nl, m.ff, (1u << k) - 1, prev_ff);
+                    return i + k;
+                }
+                lines += count_lines(m.nl, m.ff, 0xFFFFu, prev_ff);
+                prev_ff = (m.ff >> 15) & 1u;
+            }
+
+            return block_stop_tail(p, i, n, lines, prev_ff);
+        }
+#endif
+
+        /*==================== AVX2 ====================*/
+#if SC_HAVE_AVX2
+
+        SC_TARGET_AVX2
+        size_t blanks_avx2(const char *p, size_t n, int &lines) {
+            size_t i = 0;
+            bool prev_ff = false;
+
+            const __m256i nine = _mm256_set1_epi8('\t');
+            const __m256i four = _mm256_set1_epi8('\r' - '\t');
+            const __m256i space = _mm256_set1_epi8(' ');
+            const __m256i nl = _mm256_set1_epi8('\n');
+            const __m256i ff = _mm256_set1_epi8('\f');
+
+            for (; i + 32 <= n; i += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                __m256i d = _mm256_sub_epi8(v, nine);
+                __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(d, four), d);
+                __m256i ws = _mm256_or_si256(ctl, _mm256_cmpeq_epi8(v, space));
+                uint32_t other = ~uint32_t(_mm256_movemask_epi8(ws));
+                uint32_t m_nl = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)));
+                uint32_t m_ff = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, ff)));
+
+                if (other) {
+                    int k = __builtin_ctz(other);
+                    uint32_t below = k == 0 ? 0u : (0xFFFFFFFFu >> (32 - k));
+                    lines += count_lines(m_nl, m_ff, below, prev_ff);
+                    return i + k;
+                }
+                lines += count_lines(m_nl, m_ff, 0xFFFFFFFFu, prev_ff);
+                prev_ff = m_ff >> 31;
+            }
+
+            return blanks_tail(p, i, n, lines, prev_ff);
+        }
+
+        SC_TARGET_AVX2
+        size_t line_end_avx2(const char *p, size_t n) {
+            size_t i = 0;
+            const __m256i nl = _mm256_set1_epi8('\n');
+            const __m256i ff = _mm256_set1_epi8('\f');
+
+            for (; i + 32 <= n; i += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, nl),
+                        _mm256_cmpeq_epi8(v, ff));
+                uint32_t m = uint32_t(_mm256_movemask_epi8(hit));
+                if (m) {
+                    return i + __builtin_ctz(m);
+                }
+            }
+            return line_end_tail(p, i, n);
+        }
+
+        SC_TARGET_AVX2
+        size_t block_stop_avx2(const char *p, size_t n, int &lines) {
+            size_t i = 0;
+            bool prev_ff = false;
+            const __m256i star = _mm256_set1_epi8('*');
+            const __m256i nl = _mm256_set1_epi8('\n');
+            const __m256i ff = _mm256_set1_epi8('\f');
+
+            for (; i + 32 <= n; i += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+                uint32_t stars = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, star)));
+                uint32_t m_nl = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)));
+                uint32_t m_ff = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, ff)));
+
+                if (stars) {
+                    int k = __builtin_ctz(stars);
+                    uint32_t below = k == 0 ? 0u : (0xFFFFFFFFu >> (32 - k));
+                    lines += count_lines(m_nl, m_ff, below, prev_ff);
+                    return i + k;
+                }
+                lines += count_lines(m_nl, m_ff, 0xFFFFFFFFu, prev_ff);
+                prev_ff = m_ff >> 31;
+            }
+
+            return block_stop_tail(p, i, n, lines, prev_ff);
+        }
+#endif
+
+        /*==================== dispatch ====================*/
+
+        struct kernel_table {
+            Kernel kind;
+            size_t (*blanks)(const char *, size_t, int &);
+            size_t (*line_end)(const char *, size_t);
+            size_t (*block_stop)(const char *, size_t, int &);
+        };
+
+        const kernel_table scalar_table {
+            Kernel::SCALAR, blanks_scalar, line_end_scalar, block_stop_scalar
+        };
+#if SC_HAVE_SSE2
+        const kernel_table sse2_table {
+            Kernel::SSE2, blanks_sse2, line_end_sse2, block_stop_sse2
+        };
+#endif
+#if SC_HAVE_AVX2
+        const kernel_table avx2_table {
+            Kernel::AVX2, blanks_avx2, line_end_avx2, block_stop_avx2
+        };
+#endif
+
+        const kernel_table *table_for(Kernel k) {
+            switch (k) {
+                case Kernel::SCALAR :
+                    return &scalar_table;
+                case Kernel::SSE2 :
+#if SC_HAVE_SSE2
+                    return &sse2_table;
+#else
+                    return nullptr;
+#endif
+                case Kernel::AVX2 :
+#if SC_HAVE_AVX2
+                    __builtin_cpu_init();
+                    if (__builtin_cpu_supports("avx2")) {
+                        return &avx2_table;
+                    }
+#endif
+                    return nullptr;
+            }
+            return nullptr;
+        }
+
+        const kernel_table *best_table() {
+            for (auto k : { Kernel::AVX2, Kernel::SSE2 }) {
+                if (auto *t = table_for(k)) return t;
+            }
+            return &scalar_table;
+        }
+
+        const kernel_table *&active() {
+            static const kernel_table *table = best_table();
+            return table;
+        }
+    }
+
+    size_t blanks(const char *p, size_t n, int &lines) {
+        return active()->blanks(p, n, lines);
+    }
+
+    size_t line_end(const char *p, size_t n) {
+        return active()->line_end(p, n);
+    }
+
+    size_t block_stop(const char *p, size_t n, int &lines) {
+        return active()->block_stop(p, n, lines);
+    }
+
+    Kernel active_kernel() {
+        return active()->kind;
+    }
+
+    bool kernel_supported(Kernel k) {
+        return table_for(k) != nullptr;
+    }
+
+    bool use_kernel(Kernel k) {
+        auto *t = table_for(k);
+        if (!t) return false;
+        active() = t;
+        return true;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+namespace simpleConfig {
+
+    // Wide-stride scanners used by ParserBase::skip().
+    //
+    // Each scanner looks at [p, p+n) and returns how many bytes can be
+    // consumed. Line breaks follow the parser's rules: '\n', '\f' and
+    // the pair '\f\n' each count as a single line.
+    //
+    // The implementation (scalar, SSE2 or AVX2) is picked at runtime
+    // the first time any of these is called.
+    namespace skip_scan {
+
+        enum class Kernel { SCALAR, SSE2, AVX2 };
+
+        // Length of the leading run of whitespace.
+        // Adds the line breaks in the run to `lines`.
+        size_t blanks(const char *p, size_t n, int &lines);
+
+        // Offset of the first '\n' or '\f' (n if there is none).
+        size_t line_end(const char *p, size_t n);
+
+        // Offset of the first '*' (n if there is none).
+        // Adds the line breaks before it to `lines`.
+        size_t block_stop(const char *p, size_t n, int &lines);
+
+        // The kernel currently in use.
+        Kernel active_kernel();
+
+        // Is the kernel usable on this machine ?
+        bool kernel_supported(Kernel k);
+
+        // Force a particular kernel (mostly for testing).
+        // Returns false (and changes nothing) if it isn't supported.
+        bool use_kernel(Kernel k);
+    }
+}
@@ -0,0 +1,317 @@
+#include <snapshot.hpp>
+
+#include <cstring>
+#include <deque>
+#include <vector>
+
+using namespace std::literals::string_literals;
+
+namespace simpleConfig::snapshot {
+
+    namespace {
+
+        struct node_record {
+            uint8_t type;
+            uint8_t unused[3];
+            uint32_t count;
+            uint64_t value;
+        };
+
+        struct key_record {
+            uint32_t offset;
+            uint32_t len;
+        };
+
+        static_assert(sizeof(node_record) == 16);
+        static_assert(sizeof(key_record) == 8);
+        static_assert(sizeof(snapshot_header) % 8 == 0);
+
+        //############## writing ####
+
+        class writer {
+            std::string out_;
+
+            // Room for `bytes` at the next 8 byte boundary.
+            size_t reserve(size_t bytes) {
+                out_.resize((out_.size() + 7) & ~size_t(7));
+                size_t at = out_.size();
+                out_.resize(at + bytes);
+                return at;
+            }
+
+            size_t add_bytes(std::string_view s) {
+                size_t at = out_.size();
+                out_.append(s);
+                return at;
+            }
+
+            template<typename T>
+            void put(size_t at, const T &v) {
+                std::memcpy(out_.data() + at, &v, sizeof(T));
+            }
+
+        public :
+            uint64_t nodes = 0;
+
+            // Breadth first, so the children of each composite sit
+            // together in one block.
+            std::string run(Setting &root) {
+                std::deque<std::pair<Setting *, size_t>> todo;
+                todo.emplace_back(&root, reserve(sizeof(node_record)));
+
+                while (not todo.empty()) {
+                    auto [s, at] = todo.front();
+                    todo.pop_front();
+                    ++nodes;
+
+                    node_record rec{};
+                    rec.type = uint8_t(s->get_type());
+
+                    switch (s->get_type()) {
+                        case ValType::BOOL :
+                            rec.value = s->get<bool>() ? 1 : 0;
+                            break;
+                        case ValType::INTEGER : {
+                            long v = s->get<long>();
+                            std::memcpy(&rec.value, &v, sizeof(v));
+                            break;
+                        }
+                        case ValType::FLOAT : {
+                            double v = s->get<double>();
+                            std::memcpy(&rec.value, &v, sizeof(v));
+                            break;
+                        }
+                        case ValType::STRING : {
+                            auto v = s->get<std::string_view>();
+                            rec.count = uint32_t(v.size());
+                            rec.value = add_bytes(v);
+                            break;
+                        }
+                        case ValType::GROUP : {
+                            auto count = size_t(s->count());
+                            size_t block = reserve(count * (sizeof(node_record) + sizeof(key_record)));
+                            size_t keys = block + count * sizeof(node_record);
+                            size_t n = 0;
+                            for (auto [name, child] : s->entries(Setting::KeyOrder::INSERTION)) {
+                                todo.emplace_back(&child, block + n * sizeof(node_record));
+                                key_record k{uint32_t(add_bytes(name)), uint32_t(name.size())};
+                                put(keys + n * sizeof(key_record), k);
+                                ++n;
+                            }
+                            rec.count = uint32_t(count);
+                            rec.value = block;
+                            break;
+                        }
+                        case ValType::ARRAY :
+                        case ValType::LIST : {
+                            auto count = size_t(s->count());
+                            size_t block = reserve(count * sizeof(node_record));
+                            size_t n = 0;
+                            for (auto &child : *s) {
+                                todo.emplace_back(&child, block + n * sizeof(node_record));
+                                ++n;
+                            }
+                            rec.count = uint32_t(count);
+                            rec.value = block;
+                            break;
+                        }
+                        default :
+                            break;
+                    }
+
+                    put(at, rec);
+                }
+
+                return std::move(out_);
+            }
+        };
+
+        //############## reading ####
+
+        class reader {
+            std::string_view payload_;
+            uint64_t nodes_left_;
+            std::string &error_;
+
+            bool fail(const std::string &msg) {
+                error_ = "Bad snapshot : "s + msg;
+                return false;
+            }
+
+            bool fits(uint64_t offset, uint64_t bytes) const {
+                return (offset <= payload_.size() and bytes <= payload_.size() - offset);
+            }
+
+            template<typename T>
+            T get(uint64_t at) const {
+                T v;
+                std::memcpy(&v, payload_.data() + at, sizeof(T));
+                return v;
+            }
+
+            // Give `s` the scalar value of `rec`, or check a composite.
+            bool fill(Setting &s, const node_record &rec) {
+                switch (ValType(rec.type)) {
+                    case ValType::BOOL :
+                        s.set_value(rec.value != 0);
+                        return true;
+                    case ValType::INTEGER : {
+                        long v;
+                        std::memcpy(&v, &rec.value, sizeof(v));
+                        s.set_value(v);
+                        return true;
+                    }
+                    case ValType::FLOAT : {
+                        double v;
+                        std::memcpy(&v, &rec.value, sizeof(v));
+                        s.set_value(v);
+                        return true;
+                    }
+                    case ValType::STRING :
+                        if (not fits(rec.value, rec.count)) return fail("string out of range");
+                        s.set_view(payload_.substr(rec.value, rec.count));
+                        return true;
+                    case ValType::GROUP :
+                    case ValType::LIST :
+                    case ValType::ARRAY :
+                        return true;
+                    default :
+                        return fail("unknown node type");
+                }
+            }
+
+        public :
+            reader(std::string_view payload, uint64_t nodes, std::string &error) :
+                payload_{payload}, nodes_left_{nodes}, error_{error} {}
+
+            bool run(Setting &root) {
+                if (not fits(0, sizeof(node_record))) return fail("no root");
+                auto root_rec = get<node_record>(0);
+                if (ValType(root_rec.type) != ValType::GROUP) return fail("root is not a group");
+
+                std::vector<std::pair<Setting *, uint64_t>> todo;
+                todo.emplace_back(&root, 0);
+
+                while (not todo.empty()) {
+                    auto [parent, at] = todo.back();
+                    todo.pop_back();
+
+                    auto rec = get<node_record>(at);
+                    bool is_group = (ValType(rec.type) == ValType::GROUP);
+                    uint64_t count = rec.count;
+                    uint64_t block = rec.value;
+
+                    // Blocks always come after the record that names them,
+                    // which also rules out cycles.
+                    uint64_t per_child = sizeof(node_record) + (is_group ? sizeof(key_record) : 0);
+                    if (count > 0 and (block <= at or not fits(block, count * per_child))) {
+                        return fail("child block out of range");
+                    }
+                    if (count > nodes_left_) return fail("too many nodes");
+                    nodes_left_ -= count;
+
+                    parent->reserve(count);
+
+                    uint64_t keys = block + count * sizeof(node_record);
+                    for (uint64_t n = 0; n < count; ++n) {
+                        auto child_at = block + n * sizeof(node_record);
+                        auto child_rec = get<node_record>(child_at);
+                        auto type = ValType(child_rec.type);
+
+                        Setting *child;
+                        if (is_group) {
+                            auto k = get<key_record>(keys + n * sizeof(key_record));
+                            if (not fits(k.offset, k.len)) return fail("key out of range");
+                            child = parent->try_add_child(payload_.substr(k.offset, k.len), type);
+                        } else {
+                            child = parent->try_add_child(type);
+                        }
+                        if (not child) return fail("child does not fit its parent");
+
+                        if (not fill(*child, child_rec)) return false;
+                        if (child->is_composite()) {
+                            todo.emplace_back(child, child_at);
+                        }
+                    }
+                }
+
+                return true;
+            }
+        };
+    }
+
+    uint64_t checksum(std::string_view bytes) {
+        uint64_t h = 0xcbf29ce484222325ull;
+        const char *p = bytes.data();
+        size_t n = bytes.size();
+        size_t i = 0;
+
+        // A word at a time; this is only to catch damage.
+        for (; i + 8 <= n; i += 8) {
+            uint64_t w;
+            std::memcpy(&w, p + i, 8);
+            h = (h ^ w) * 0x100000001b3ull;
+            h ^= h >> 32;
+        }
+        for (; i < n; ++i) {
+            h = (h ^ uint8_t(p[i])) * 0x100000001b3ull;
+        }
+        return h;
+    }
+
+    std::string write(Setting &root) {
+        writer w;
+        std::string payload = w.run(root);
+
+        snapshot_header hdr{};
+        std::memcpy(hdr.magic, magic, sizeof(magic));
+        hdr.version = version;
+        hdr.byte_order = byte_order;
+        hdr.payload_size = payload.size();
+        hdr.checksum = checksum(payload);
+        hdr.node_count = w.nodes;
+
+        std::string image(sizeof(hdr), '\0');
+        std::memcpy(image.data(), &hdr, sizeof(hdr));
+        image += payload;
+        return image;
+    }
+
+    bool read(std::string_view image, Setting &root, std::string &error) {
+        snapshot_header hdr;
+        if (image.size() < sizeof(hdr)) {
+            error = "Bad snapshot : too short"s;
+            return false;
+        }
+        std::memcpy(&hdr, image.data(), sizeof(hdr));
+
+        if (std::memcmp(hdr.magic, magic, sizeof(magic)) != 0) {
+            error = "Not a snapshot"s;
+            return false;
+        }
+        if (hdr.byte_order != byte_order) {
+            error = "Snapshot was written on a machine with a different byte order"s;
+            return false;
+        }
+        if (hdr.version != version) {
+            error = "Snapshot version "s + std::to_string(hdr.version) +
+                " is not supported (expected " + std::to_string(version) + ")";
+            return false;
+        }
+
+        auto payload = image.substr(sizeof(hdr));
+        if (payload.size() != hdr.payload_size) {
+            error = "Bad snapshot : wrong size"s;
+            return false;
+        }
+        if (checksum(payload) != hdr.checksum) {
+            error = "Bad snapshot : checksum mismatch"s;
+            return false;
+        }
+
+        // The root is already there.
+        reader r{payload, hdr.node_count > 0 ? hdr.node_count - 1 : 0, error};
+        return r.run(root);
+    }
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "setting.hpp"
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace simpleConfig {
+
+    // Binary snapshots of a Setting tree, for loading a config again
+    // without parsing it.
+    //
+    // An image is a snapshot_header followed by the payload. Integers are
+    // in the byte order of the machine that wrote them; the header says
+    // which, and other machines refuse the image. Offsets count from the
+    // start of the payload, so an image can be mapped at any address.
+    //
+    // The payload holds 16 byte node records and the bytes of strings and
+    // keys. A node record is
+    //
+    //   uint8  type        a ValType
+    //   uint8  (unused) x 3
+    //   uint32 count       children of a composite, or length of a string
+    //   uint64 value       the bits of a bool, long or double, or the
+    //                      offset of a string's bytes, or the offset of a
+    //                      composite's block of children
+    //
+    // A block is `count` node records. For a group it is followed by
+    // `count` key records (offset, length) naming the children in order.
+    // The root group's record is at offset 0, and every block comes after
+    // the record that refers to it.
+    struct snapshot_header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t payload_size;
+        uint64_t checksum;
+        uint64_t node_count;
+    };
+
+    namespace snapshot {
+
+        inline constexpr char magic[8] = {'S', 'C', 'F', 'G', 'S', 'N', 'A', 'P'};
+        inline constexpr uint32_t version = 1;
+        inline constexpr uint32_t byte_order = 0x01020304;
+
+        // The checksum kept in the header, taken over the payload.
+        uint64_t checksum(std::string_view bytes);
+
+        // Make an image of the tree below `root`, which must be a group.
+        std::string write(Setting &root);
+
+        // Build the tree described by `image` under `root`, which must be
+        // an empty group. String values are views into the image, so it
+        // must outlive the tree. On a bad image, returns false and sets
+        // `error`; `root` may then be partly filled in.
+        bool read(std::string_view image, Setting &root, std::string &error);
+    }
+
+}
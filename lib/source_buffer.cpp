@@ -0,0 +1,113 @@
+#include <source_buffer.hpp>
+
+#include <cstring>
+#include <cerrno>
+
+using namespace std::literals::string_literals;
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SC_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <sstream>
+#endif
+
+namespace simpleConfig {
+
+    void SourceBuffer::reset() {
+        release();
+        stats_ = {};
+    }
+
+    void SourceBuffer::release() {
+#if SC_HAVE_MMAP
+        if (map_) {
+            ::munmap(const_cast<char *>(map_), map_len_);
+        }
+#endif
+        map_ = nullptr;
+        map_len_ = 0;
+        data_.clear();
+        data_.shrink_to_fit();
+    }
+
+    void SourceBuffer::assign(std::string &&text) {
+        reset();
+        data_ = std::move(text);
+        stats_.bytes = data_.size();
+    }
+
+#if SC_HAVE_MMAP
+
+    bool SourceBuffer::load(const std::string &file_name, std::string &error) {
+        reset();
+
+        int fd = ::open(file_name.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = "Could not open "s + file_name + " : " + std::strerror(errno);
+            return false;
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0 and S_ISREG(st.st_mode) and st.st_size > 0) {
+            size_t len = size_t(st.st_size);
+            void *p = ::mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ::madvise(p, len, MADV_SEQUENTIAL);
+                ::close(fd);
+                map_ = static_cast<const char *>(p);
+                map_len_ = len;
+                stats_.bytes = len;
+                stats_.mapped = true;
+                return true;
+            }
+            // Fall through and read it instead.
+            data_.reserve(len);
+        }
+
+        // Pipes, devices, empty files or anything mmap refused.
+        char chunk[64 * 1024];
+        while (true) {
+            auto got = ::read(fd, chunk, sizeof(chunk));
+            if (got > 0) {
+                data_.append(chunk, size_t(got));
+            } else if (got == 0) {
+                break;
+            } else if (errno != EINTR) {
+                error = "Error reading "s + file_name + " : " + std::strerror(errno);
+                ::close(fd);
+                data_.clear();
+                return false;
+            }
+        }
+
+        ::close(fd);
+        stats_.bytes = data_.size();
+        return true;
+    }
+
+#else
+
+    bool SourceBuffer::load(const std::string &file_name, std::string &error) {
+        reset();
+
+        std::ifstream strm{file_name, std::ios_base::binary};
+        if (not strm) {
+            error = "Could not open "s + file_name;
+            return false;
+        }
+
+        std::ostringstream buffer;
+        buffer << strm.rdbuf();
+        data_ = buffer.str();
+        stats_.bytes = data_.size();
+        return true;
+    }
+
+#endif
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace simpleConfig {
+
+    // How the text of the last parse_file() was brought into memory.
+    struct input_stats {
+        size_t bytes = 0;
+        bool mapped = false;
+        bool cached = false;    // restored from the parse cache
+    };
+
+    // Holds the text of a file for the parser.
+    //
+    // Regular files are memory mapped (private, read only, with a
+    // sequential access hint) so the parser reads the page cache
+    // directly. Pipes and other files that can't be mapped are read
+    // once into a string.
+    class SourceBuffer {
+        std::string data_;
+        const char *map_ = nullptr;
+        size_t map_len_ = 0;
+        input_stats stats_;
+
+    public :
+        SourceBuffer() = default;
+        SourceBuffer(const SourceBuffer &) = delete;
+        SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+        ~SourceBuffer() { reset(); }
+
+        // Load the named file. On failure, returns false and sets `error`.
+        bool load(const std::string &file_name, std::string &error);
+
+        // Take ownership of text that is already in memory.
+        void assign(std::string &&text);
+
+        // Drop the text and the stats.
+        void reset();
+
+        // Drop the text, but keep the stats.
+        void release();
+
+        std::string_view text() const {
+            if (map_) return {map_, map_len_};
+            return data_;
+        }
+
+        size_t size() const { return text().size(); }
+
+        bool is_mapped() const { return map_ != nullptr; }
+
+        const input_stats &stats() const { return stats_; }
+    };
+
+}
@@ -0,0 +1,83 @@
+#include <trace_recorder.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <ostream>
+
+namespace simpleConfig {
+
+    namespace {
+
+        void write_string(std::ostream &strm, std::string_view s) {
+            strm << '"';
+            for (char c : s) {
+                if (c == '"' or c == '\\') {
+                    strm << '\\' << c;
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    char hex[8];
+                    std::snprintf(hex, sizeof(hex), "\\u%04x", unsigned(c));
+                    strm << hex;
+                } else {
+                    strm << c;
+                }
+            }
+            strm << '"';
+        }
+
+        // Trace event times are in microseconds.
+        void write_micros(std::ostream &strm, TraceRecorder::clock::duration d) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+            char text[32];
+            std::snprintf(text, sizeof(text), "%lld.%03lld",
+                (long long)(ns / 1000), (long long)(ns % 1000));
+            strm << text;
+        }
+    }
+
+    void TraceRecorder::add(const char *name, const char *category, std::string detail,
+            clock::time_point start, clock::time_point end) {
+        auto id = std::this_thread::get_id();
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        auto iter = std::find(threads_.begin(), threads_.end(), id);
+        auto thread = uint32_t(iter - threads_.begin());
+        if (iter == threads_.end()) {
+            threads_.push_back(id);
+        }
+
+        events_.push_back(event{name, category, std::move(detail),
+            start - origin_, end - start, thread});
+    }
+
+    void TraceRecorder::write_json(std::ostream &strm) const {
+        auto copy = events();
+
+        // Viewers want the spans of a thread in order.
+        std::stable_sort(copy.begin(), copy.end(), [](const event &a, const event &b) {
+            return a.start < b.start;
+        });
+
+        strm << "{\"traceEvents\":[";
+        bool first = true;
+        for (auto &e : copy) {
+            strm << (first ? "\n" : ",\n") << "{\"name\":";
+            first = false;
+            write_string(strm, e.name);
+            strm << ",\"cat\":";
+            write_string(strm, e.category);
+            strm << ",\"ph\":\"X\",\"ts\":";
+            write_micros(strm, e.start);
+            strm << ",\"dur\":";
+            write_micros(strm, e.length);
+            strm << ",\"pid\":1,\"tid\":" << e.thread;
+            if (not e.detail.empty()) {
+                strm << ",\"args\":{\"key\":";
+                write_string(strm, e.detail);
+                strm << "}";
+            }
+            strm << "}";
+        }
+        strm << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace simpleConfig {
+
+    // Collects timed spans of work (see trace_span) and writes them as
+    // Chrome trace events, for chrome://tracing or Perfetto.
+    //
+    // Spans are kept in memory until write_json() is called, so that
+    // recording one costs two clock reads and an append. They may be
+    // recorded from several threads at once.
+    class TraceRecorder {
+    public :
+        using clock = std::chrono::steady_clock;
+
+        struct event {
+            const char *name;
+            const char *category;
+            std::string detail;         // shown as args.key, if not empty
+            clock::duration start;      // since the recorder was made
+            clock::duration length;
+            uint32_t thread;
+        };
+
+        // Groups and arrays with fewer children than this are not given
+        // spans of their own when they are validated.
+        size_t min_children = 1024;
+
+        TraceRecorder() : origin_{clock::now()} {}
+
+        TraceRecorder(const TraceRecorder &) = delete;
+        TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+        clock::time_point origin() const { return origin_; }
+
+        void add(const char *name, const char *category, std::string detail,
+                clock::time_point start, clock::time_point end);
+
+        // True if a subtree this size gets a span of its own.
+        bool wants(size_t children) const { return children >= min_children; }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> lock{mutex_};
+            return events_.size();
+        }
+
+        std::vector<event> events() const {
+            std::lock_guard<std::mutex> lock{mutex_};
+            return events_;
+        }
+
+        void clear() {
+            std::lock_guard<std::mutex> lock{mutex_};
+            events_.clear();
+        }
+
+        // The spans so far, as a JSON object in the trace event format.
+        void write_json(std::ostream &strm) const;
+
+    private :
+        clock::time_point origin_;
+
+        mutable std::mutex mutex_;
+        std::vector<event> events_;
+
+        // Threads are numbered in the order they first record a span.
+        std::vector<std::thread::id> threads_;
+    };
+
+    // Records the time from its construction to its destruction as a span
+    // in `rec`. Does nothing at all if `rec` is null.
+    class trace_span {
+        TraceRecorder *rec_;
+        const char *name_;
+        const char *category_;
+        std::string detail_;
+        TraceRecorder::clock::time_point start_;
+
+    public :
+        trace_span(TraceRecorder *rec, const char *name, const char *category,
+                std::string_view detail = {}) :
+            rec_{rec}, name_{name}, category_{category}
+        {
+            if (rec_) {
+                detail_.assign(detail);
+                start_ = TraceRecorder::clock::now();
+            }
+        }
+
+        ~trace_span() {
+            if (rec_) {
+                rec_->add(name_, category_, std::move(detail_), start_,
+                    TraceRecorder::clock::now());
+            }
+        }
+
+        trace_span(const trace_span &) = delete;
+        trace_span &operator=(const trace_span &) = delete;
+    };
+
+}
@@ -0,0 +1,281 @@
+#pragma once
+
+#include "setting_builder.hpp"
+#include "schema_program.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace simpleConfig {
+
+    // A SettingBuilder that checks the config against a SchemaProgram
+    // while it is being parsed, instead of walking the finished tree.
+    //
+    // Keys are looked up when they are lexed, types are checked before
+    // each value is added, ranges and enums as each scalar is added, array
+    // lengths when the array closes, and required keys and defaults when
+    // the group closes. The checks and messages are those of
+    // ProgramValidator, but the parse stops (Action::STOP) at the first
+    // failed check, so only that one error is reported, with its place in
+    // the input.
+    //
+    // The implicit top level group has no end_group() : call finish()
+    // after a parse that wasn't stopped.
+    struct ValidatingBuilder : public SettingBuilder {
+
+        ValidatingBuilder(Setting *root, const SchemaProgram &p, error_list &errlist) :
+            SettingBuilder{root}, program{p}, checker{p, errlist}
+        {
+            push(Kind::GROUP, &program.root());
+        }
+
+        bool failed() const { return failed_; }
+
+        // Checks the top level group. Returns true if the whole config
+        // passed.
+        bool finish() {
+            if (not failed_) {
+                close_group();
+            }
+            return not failed_;
+        }
+
+        Action key(std::string_view name) override {
+            auto action = SettingBuilder::key(name);
+            if (action != Action::CONTINUE) {
+                return action;
+            }
+
+            auto &f = frames_.back();
+            expect_ = nullptr;
+            if (not f.c) {
+                return Action::CONTINUE;
+            }
+
+            auto &b = program.block_of(*f.c);
+            int n = program.find(b, name);
+            if (n >= 0) {
+                seen_[f.seen_begin + size_t(n) / 64] |= uint64_t(1) << (n % 64);
+                expect_ = &program.at(program.slot_at(b, uint32_t(n)).check);
+            } else if (b.star >= 0) {
+                expect_ = &program.at(uint32_t(b.star));
+                f.saw_star = true;
+            } else {
+                return fail("Key = "s + std::string(name) + " is not allowed.");
+            }
+            key_.assign(name);
+            return Action::CONTINUE;
+        }
+
+        Action begin_group() override {
+            const check *c = nullptr;
+            if (not expect(ValType::GROUP, c)) return Action::STOP;
+            // Elements of arrays of groups are checked against the block
+            // of the array itself.
+            if (frames_.back().kind == Kind::ARRAY and c and c->array_type != ValType::GROUP) {
+                c = nullptr;
+            }
+            SettingBuilder::begin_group();
+            push(Kind::GROUP, c);
+            return Action::CONTINUE;
+        }
+
+        Action begin_array() override {
+            const check *c = nullptr;
+            if (not expect(ValType::ARRAY, c)) return Action::STOP;
+            if (frames_.back().kind == Kind::ARRAY) {
+                c = nullptr;
+            }
+            SettingBuilder::begin_array();
+            push(Kind::ARRAY, c);
+            return Action::CONTINUE;
+        }
+
+        Action begin_list() override {
+            const check *c = nullptr;
+            if (not expect(ValType::LIST, c)) return Action::STOP;
+            SettingBuilder::begin_list();
+            push(Kind::LIST, nullptr);
+            return Action::CONTINUE;
+        }
+
+        Action end_group() override {
+            if (not close_group()) return Action::STOP;
+            return SettingBuilder::end_group();
+        }
+
+        Action end_array() override {
+            auto &f = frames_.back();
+            if (f.c) {
+                auto *s = top();
+                if (s->array_type() != f.c->array_type) {
+                    // Only an empty array gets here; elements are checked
+                    // as they come.
+                    return fail("Key has wrong type for array elements.");
+                }
+                auto length = s->count();
+                if (f.c->length_max > 0 and (length < f.c->length_min or length > f.c->length_max)) {
+                    return fail("Number of array elements is out of range");
+                }
+            }
+            pop();
+            return SettingBuilder::end_array();
+        }
+
+        Action end_list() override {
+            pop();
+            return SettingBuilder::end_list();
+        }
+
+        Action bool_value(bool v) override {
+            return scalar(ValType::BOOL, [&](Setting *s) { s->set_value(v); });
+        }
+
+        Action integer_value(long v) override {
+            return scalar(ValType::INTEGER, [&](Setting *s) { s->set_value(v); });
+        }
+
+        Action float_value(double v) override {
+            return scalar(ValType::FLOAT, [&](Setting *s) { s->set_value(v); });
+        }
+
+        Action string_value(std::string_view v, bool in_source) override {
+            return scalar(ValType::STRING, [&](Setting *s) {
+                if (borrow_strings and in_source) {
+                    s->set_view(v);
+                } else {
+                    SC_STAT(if (stats) stats->string_bytes_copied += v.size();)
+                    s->set_value(std::string(v));
+                }
+            });
+        }
+
+    private :
+        using check = SchemaProgram::check;
+
+        enum class Kind { GROUP, ARRAY, LIST };
+
+        // What is open. `c` is null when nothing inside is checked.
+        struct frame {
+            Kind kind;
+            const check *c;
+            size_t seen_begin;      // in seen_, for groups
+            bool saw_star;
+        };
+
+        const SchemaProgram &program;
+        ProgramValidator checker;
+
+        std::vector<frame> frames_;
+
+        // Which slots each open group has had, one run of words per frame.
+        std::vector<uint64_t> seen_;
+
+        // The check for the value after the last key(), and that key.
+        const check *expect_ = nullptr;
+        std::string key_;
+
+        bool failed_ = false;
+
+        Action fail(const std::string &msg) {
+            checker.at = loc;
+            checker.fail(msg);
+            failed_ = true;
+            return Action::STOP;
+        }
+
+        void push(Kind kind, const check *c) {
+            frame f{kind, c, seen_.size(), false};
+            if (kind == Kind::GROUP and c) {
+                seen_.resize(seen_.size() + (program.block_of(*c).slot_count + 63) / 64, 0);
+            }
+            frames_.push_back(f);
+        }
+
+        void pop() {
+            seen_.resize(frames_.back().seen_begin);
+            frames_.pop_back();
+        }
+
+        // The check for a value of type `t` about to be added to the open
+        // group or array, in `c`. Returns false if it has the wrong type.
+        bool expect(ValType t, const check *&c) {
+            auto &f = frames_.back();
+            c = nullptr;
+            if (not f.c) {
+                return true;
+            }
+
+            if (f.kind == Kind::GROUP) {
+                c = expect_;
+                expect_ = nullptr;
+                if (c and c->vtype != ValType::ANY and t != c->vtype) {
+                    fail("Key = "s + key_ + " has wrong type.");
+                    return false;
+                }
+            } else if (f.kind == Kind::ARRAY) {
+                c = f.c;
+                if (t != c->array_type) {
+                    fail("Key has wrong type for array elements.");
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        template <typename F>
+        Action scalar(ValType t, F set) {
+            const check *c = nullptr;
+            if (not expect(t, c)) return Action::STOP;
+
+            auto in_array = (frames_.back().kind == Kind::ARRAY);
+            auto *s = next(t);
+            set(s);
+
+            if (c) {
+                checker.at = loc;
+                bool ok = in_array
+                    ? checker.run_scalar(s, *c, c->array_type, c->element_op)
+                    : checker.run_scalar(s, *c, c->vtype, c->value_op);
+                if (not ok) {
+                    failed_ = true;
+                    return Action::STOP;
+                }
+            }
+            return Action::CONTINUE;
+        }
+
+        // The checks for the end of the open group, then drop it.
+        bool close_group() {
+            auto &f = frames_.back();
+            if (f.c) {
+                auto &b = program.block_of(*f.c);
+                if (b.star >= 0 and b.star_required and not f.saw_star) {
+                    fail("Key = *"s + " requires a 'star' entry");
+                    return false;
+                }
+
+                auto *group = top();
+                auto *needed = program.needed(b);
+                size_t words = (b.slot_count + 63) / 64;
+                for (size_t w = 0; w < words; ++w) {
+                    uint64_t missing = needed[w] & ~seen_[f.seen_begin + w];
+                    for (uint32_t bit = 0; missing; ++bit, missing >>= 1) {
+                        if (not (missing & 1u)) continue;
+                        auto &s = program.slot_at(b, uint32_t(w * 64 + bit));
+                        if (s.required) {
+                            fail("Required key = "s + std::string(program.key(s)) + " is not present.");
+                            return false;
+                        }
+                        group->add_child(program.key(s), *s.dflt);
+                        SC_STAT(if (stats) stats->defaults_added += 1;)
+                    }
+                }
+            }
+            pop();
+            return true;
+        }
+    };
+
+}
@@ -18,7 +18,7 @@ namespace simpleConfig {
         }
 
         if (setting_ptr->get_type() != stype) {
-            record_error("setting and schema value type don't match", {});
+            record_error("setting and schema value type don't match", where(setting_ptr));
             return false;
         }
         
@@ -28,19 +28,12 @@ namespace simpleConfig {
                 //std::cout << "  Checking key " << sett_name << " as range limited "<<
                 //    snode->int_range << "\n";
                 if (v > schema_ptr->int_range.max || v < schema_ptr->int_range.min ) {
-                    record_error( "int value is out of range" , {});
+                    record_error( "int value is out of range" , where(setting_ptr));
                     return false;
                 }
             } else if (schema_ptr->enum_values) {
-                bool found = false;
-                for (auto &e : *(schema_ptr->enum_values)) {
-                    if (e.get<int>() == v) {
-                        found = true;
-                        break;
-                    }
-                }
-                if (not found) {
-                    record_error("Int value is not in enum list", {});
+                if (not schema_ptr->enum_set.contains(v)) {
+                    record_error("Int value is not in enum list", where(setting_ptr));
                     return false;
                 }
             }
@@ -51,39 +44,21 @@ namespace simpleConfig {
                 //std::cout << "  Checking key " << sett_name << " as range limited "<<
                 //    snode->float_range << "\n";
                 if (v > schema_ptr->float_range.max || v < schema_ptr->float_range.min ) {
-                    record_error( "float value is out of range" , {});
+                    record_error( "float value is out of range" , where(setting_ptr));
                     return false;
                 }
             } else if (schema_ptr->enum_values) {
-                bool found = false;
-                for (auto &e : *(schema_ptr->enum_values)) {
-                    if (e.get<double>() == v) {
-                        found = true;
-                        break;
-                    }
-                }
-                if (not found) {
-                    record_error("Float value is not in enum list", {});
+                if (not schema_ptr->enum_set.contains(v)) {
+                    record_error("Float value is not in enum list", where(setting_ptr));
                     return false;
                 }
 
             }
         }  else if (stype == ValType::STRING) {
-            auto v = setting_ptr->get<std::string>();
+            auto v = setting_ptr->get<std::string_view>();
             if (schema_ptr->enum_values) {
-                bool found = false;
-                //std::cout << "   Checking that '" << v << "' is in enum list\n";
-                for (auto &e : *(schema_ptr->enum_values)) {
-                    auto enum_value = e.get<std::string>();
-                    //std::cout << "   - checking against '" << enum_value << "'\n";
-                    if (e.get<std::string>() == v) {
-                        //std::cout << "   - - YEA!\n";
-                        found = true;
-                        break;
-                    }
-                }
-                if (not found) {
-                    record_error("String value is not in enum list", {});
+                if (not schema_ptr->enum_set.contains(v)) {
+                    record_error("String value is not in enum list", where(setting_ptr));
                     return false;
                 }
 
@@ -99,12 +74,13 @@ namespace simpleConfig {
             Setting * setting_ptr, 
             const SchemaNode* schema_ptr ) {
 
+        trace_span span{trace_for(setting_ptr), "validate array", "validate"};
         bool okay = true;
 
         if (setting_ptr->array_type() != 
             schema_ptr->array_type) {
 
-            record_error("Key has wrong type for array elements.", {});
+            record_error("Key has wrong type for array elements.", where(setting_ptr));
                 return false;
 
         }
@@ -112,7 +88,7 @@ namespace simpleConfig {
         auto range = schema_ptr->length;
         auto length = setting_ptr->count();
         if (range.max > 0 && (length < range.min || length > range.max)) {
-            record_error("Number of array elements is out of range", {});
+            record_error("Number of array elements is out of range", where(setting_ptr));
             okay = false;
 
         }
@@ -136,9 +112,7 @@ namespace simpleConfig {
             Setting * setting_ptr, 
             const SchemaNode* schema_ptr ) {
     
-        // Keep track of the keys we've dealt with
-        std::set<std::string> seen;
-
+        trace_span span{trace_for(setting_ptr), "validate group", "validate"};
         auto star = schema_ptr->subkeys.find("*");
         bool has_star = (star != schema_ptr->subkeys.end());
         bool saw_star_key = false;
@@ -147,9 +121,24 @@ namespace simpleConfig {
             star_required = star->second.required;
         }
 
+        // Which slots of the schema the config has. Only if the slots
+        // are those of the subkeys there are now; a tree that had keys
+        // added after index_slots() (or never had it run, or had subkeys
+        // removed) is checked with a lookup of each key instead.
+        bool indexed = schema_ptr->slots_current and
+            (schema_ptr->slots.size() + (has_star ? 1 : 0) == schema_ptr->subkeys.size());
+        size_t words = indexed ? schema_ptr->needed.size() : 0;
+        uint64_t small[4] = {0, 0, 0, 0};
+        std::vector<uint64_t> large;
+        uint64_t *seen = small;
+        if (words > 4) {
+            large.assign(words, 0);
+            seen = large.data();
+        }
+
         // Run through the config making sure the keys that are there
         // are supposed to be there and of the correct type
-        for (const auto& [sett_name, setting] : setting_ptr->enumerate()) {
+        for (const auto& [sett_name, setting] : setting_ptr->entries()) {
             const auto & schema_match = schema_ptr->subkeys.find(sett_name);
 
             //std::cout << "Check key - " << setting_iter.first << "\n";
@@ -172,20 +161,26 @@ namespace simpleConfig {
                 snode = &(schema_match->second);
                 key_name_ok = true;
                 ftype = snode->vtype;
+                if (indexed and schema_match->first != "*") {
+                    seen[snode->slot / 64] |= uint64_t(1) << (snode->slot % 64);
+                }
             }
 
             if (! key_name_ok) {
-                record_error("Key = "s + sett_name + " is not allowed.", {});
+                record_error("Key = "s + std::string(sett_name) + " is not allowed.", where(&setting));
             }
             
             if (ftype != ValType::ANY && setting.get_type() != ftype )
-                record_error("Key = "s + sett_name + " has wrong type.", {});
-            
-            seen.insert(sett_name);
+                record_error("Key = "s + std::string(sett_name) + " has wrong type.", where(&setting));
+
 
             if (snode) {
                 if (setting.is_group()) {
-                    validate_group(&setting, snode);
+                    if (leave_deferred and setting.is_deferred()) {
+                        setting.deferred()->schema = snode;
+                    } else {
+                        validate_group(&setting, snode);
+                    }
 
                 } else if (setting.is_array()) {
                     validate_array(&setting, snode);
@@ -200,22 +195,40 @@ namespace simpleConfig {
 
         if (star_required && not saw_star_key)
             record_error("Key = "s + star->first + 
-                " requires a 'star' entry", {});
+                " requires a 'star' entry", where(setting_ptr));
 
-        // Run through the schema checking that required keys
-        // were seen.
+        // The required keys and the ones with defaults that weren't
+        // seen, in key order.
 
-        for (const auto &[name, snode] : schema_ptr->subkeys) {
-            if (name == "*") {
-                continue;
+        for (size_t w = 0; w < words; ++w) {
+            uint64_t missing = schema_ptr->needed[w] & ~seen[w];
+            for (uint32_t bit = 0; missing; ++bit, missing >>= 1) {
+                if (not (missing & 1u)) continue;
+                auto *snode = schema_ptr->slots[w * 64 + bit];
+                if (snode->required) {
+                    record_error("Required key = "s + snode->name + 
+                        " is not present.", where(setting_ptr));
+
+                } else {
+                    SC_STAT(if (stats) stats->defaults_added += 1;)
+                    setting_ptr->add_child(snode->name, *snode->dflt);
+                }
             }
-            const auto &seen_iter = seen.find(name);
-            if (seen_iter == seen.end()) {
+        }
+
+        if (not indexed) {
+            // Defaults only add schema keys, so exists() still tells us
+            // what the config itself had.
+            for (const auto &[name, snode] : schema_ptr->subkeys) {
+                if (name == "*" or setting_ptr->exists(name)) {
+                    continue;
+                }
                 if (snode.required) {
-                    record_error("Required key = "s + name + 
-                        " is not present.", {});
+                    record_error("Required key = "s + name +
+                        " is not present.", where(setting_ptr));
 
                 } else if (snode.dflt) {
+                    SC_STAT(if (stats) stats->defaults_added += 1;)
                     setting_ptr->add_child(name, *snode.dflt);
                 }
             }
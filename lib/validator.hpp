@@ -4,6 +4,9 @@
 #include "schema_node.hpp"
 #include "parser_utils.hpp"
 #include "error_reporter.hpp"
+#include "line_index.hpp"
+#include "parse_stats.hpp"
+#include "trace_recorder.hpp"
 
 #include <set>
 #include <map>
@@ -16,6 +19,23 @@ namespace simpleConfig {
         Validator(error_list &errlist) :
             ErrorReporter{"Validator"s, errlist}
         {}
+
+        // When set, deferred groups (see Setting::defer()) are not loaded
+        // to be checked. They are given their schema node instead, and
+        // checked when they are loaded.
+        bool leave_deferred = false;
+
+        // The text the settings were parsed from. When set, errors are
+        // given the line of the setting they are about.
+        const LineIndex *lines = nullptr;
+
+        // Where to count the defaults added, if anywhere. Only used when
+        // built with SIMPLECONFIG_STATS.
+        parse_stats *stats = nullptr;
+
+        // Groups and arrays with at least trace->min_children children are
+        // given a span in it, if set.
+        TraceRecorder *trace = nullptr;
     
         bool validate(
                 Setting *setting_ptr, 
@@ -48,5 +68,15 @@ namespace simpleConfig {
                 Setting * setting_ptr, 
                 const SchemaNode* schema_ptr );
 
+    protected :
+        parse_loc where(const Setting *s) const {
+            return (lines and s) ? lines->loc_of(*s) : parse_loc{};
+        }
+
+        // The recorder for a span of checking `s`, or null if it is too
+        // small to have one.
+        TraceRecorder *trace_for(const Setting *s) const {
+            return (trace and trace->wants(size_t(s->count()))) ? trace : nullptr;
+        }
     };
 }
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 namespace simpleConfig {
 
-    enum class ValType { 
+    enum class ValType : unsigned char { 
         NONE, STRING, BOOL, INTEGER, 
         FLOAT, GROUP, LIST, ARRAY, ANY 
     };
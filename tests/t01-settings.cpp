@@ -4,6 +4,7 @@
 #include <simpleConfig.hpp>
 
 #include <string>
+#include <memory_resource>
 
 using namespace std::literals::string_literals;
 
@@ -199,8 +200,8 @@ TEST_CASE("Groups Enum") {
     s.add_child("b", 2);
     s.add_child("c", 3);
 
-    auto &enumer = s.enumerate();
-    auto &iter = enumer.begin();
+    auto enumer = s.enumerate();
+    auto iter = enumer.begin();
 
     CHECK(iter->first == "a");
     CHECK(iter->second.get<int>() == 1);
@@ -279,3 +280,203 @@ TEST_CASE("Arrays") {
 
     CHECK_FALSE(s.exists("happy times"));
 }
+
+TEST_CASE("String views") {
+    std::string backing = "borrowed text";
+
+    simpleConfig::Setting s{1};
+    s.set_view(backing);
+
+    CHECK(s.is_string());
+    CHECK(s.is_borrowed());
+    CHECK(s.get<std::string_view>().data() == backing.data());
+    CHECK(s.get<std::string>() == "borrowed text"s);
+
+    simpleConfig::Setting copy{s};
+    CHECK_FALSE(copy.is_borrowed());
+    CHECK(copy.get<std::string_view>().data() != backing.data());
+    CHECK(copy.get<std::string>() == "borrowed text"s);
+
+    s.set_value("owned"s);
+    CHECK_FALSE(s.is_borrowed());
+    CHECK(s.get<std::string_view>() == "owned");
+
+    simpleConfig::Setting n{3};
+    CHECK_THROWS(n.get<std::string_view>());
+}
+
+namespace {
+    // Counts what is allocated through it.
+    struct counting_resource : std::pmr::memory_resource {
+        size_t count = 0;
+
+        void *do_allocate(size_t bytes, size_t align) override {
+            ++count;
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+        void do_deallocate(void *p, size_t bytes, size_t align) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+        }
+        bool do_is_equal(const std::pmr::memory_resource &o) const noexcept override {
+            return this == &o;
+        }
+    };
+}
+
+TEST_CASE("Allocators") {
+    using ST = simpleConfig::ValType;
+    counting_resource res;
+
+    {
+        simpleConfig::Setting s{ST::GROUP, simpleConfig::Setting::allocator_type{&res}};
+        s.add_child("a long enough key to skip the small string buffer", 1);
+        auto &l = s.add_child("l", ST::LIST);
+        l.add_child("a long enough string value to skip the small string buffer"s);
+
+        CHECK(res.count > 0);
+        auto before = res.count;
+
+        CHECK(l.at(0).get_allocator().resource() == &res);
+
+        // Copies use the default allocator unless told otherwise.
+        simpleConfig::Setting c{s};
+        CHECK(c.get_allocator().resource() != &res);
+        CHECK(res.count == before);
+        CHECK(c.at("l").at(0).get<std::string>() ==
+                "a long enough string value to skip the small string buffer"s);
+    }
+}
+
+TEST_CASE("Footprint") {
+    using ST = simpleConfig::ValType;
+
+    // A leaf should fit comfortably in a cache line.
+    CHECK(sizeof(simpleConfig::Setting) <= 40);
+
+    counting_resource res;
+    simpleConfig::Setting::allocator_type a{&res};
+
+    SUBCASE("scalars and short strings don't allocate") {
+        simpleConfig::Setting i{42, a};
+        simpleConfig::Setting f{1.5, a};
+        simpleConfig::Setting b{true, a};
+        simpleConfig::Setting s{"twenty four characters.."s, a};
+
+        CHECK(res.count == 0);
+        CHECK(s.get<std::string>() == "twenty four characters.."s);
+
+        s.set_value("a string that is too long to fit inline"s);
+        CHECK(res.count == 1);
+        CHECK(s.get<std::string>() == "a string that is too long to fit inline"s);
+
+        s.set_value(3);
+        CHECK(s.get<int>() == 3);
+    }
+
+    SUBCASE("moves keep the resource") {
+        simpleConfig::Setting g{ST::GROUP, a};
+        g.add_child("x", 1);
+        auto before = res.count;
+
+        simpleConfig::Setting moved{std::move(g)};
+        CHECK(res.count == before);
+        CHECK(moved.get_allocator().resource() == &res);
+        CHECK(moved.at("x").get<int>() == 1);
+
+        // Assigning a child over its parent is fine.
+        moved = moved.at("x");
+        CHECK(moved.get<int>() == 1);
+    }
+}
+
+TEST_CASE("Group index") {
+    using ST = simpleConfig::ValType;
+    using KO = simpleConfig::Setting::KeyOrder;
+
+    // Big enough to switch from the sorted list to the hash table.
+    const int count = 500;
+
+    simpleConfig::Setting s{ST::GROUP};
+    for (int i = 0; i < count; ++i) {
+        s.add_child("k"s + std::to_string((i * 37) % count), i);
+    }
+
+    CHECK(s.count() == count);
+    CHECK_THROWS(s.add_child("k0"s, 1));
+    CHECK(s.try_add_child("k499"s, 1) == nullptr);
+
+    for (int i = 0; i < count; ++i) {
+        auto key = "k"s + std::to_string((i * 37) % count);
+        REQUIRE(s.lkup(key) != nullptr);
+        CHECK(s.at(std::string_view{key}).get<int>() == i);
+    }
+    CHECK(s.lkup("k500") == nullptr);
+    CHECK_FALSE(s.exists("nope"));
+
+    SUBCASE("alphabetical order") {
+        std::string last;
+        int seen = 0;
+        for (auto [name, value] : s.entries()) {
+            CHECK(last < name);
+            last = name;
+            ++seen;
+        }
+        CHECK(seen == count);
+    }
+
+    SUBCASE("insertion order") {
+        int i = 0;
+        for (auto [name, value] : s.entries(KO::INSERTION)) {
+            CHECK(name == "k"s + std::to_string((i * 37) % count));
+            CHECK(value.get<int>() == i);
+            ++i;
+        }
+        CHECK(i == count);
+    }
+
+    SUBCASE("copies") {
+        simpleConfig::Setting c{s};
+        c.add_child("extra", 1);
+        CHECK(c.at("k123").get<int>() == s.at("k123").get<int>());
+        CHECK(c.exists("extra"));
+        CHECK_FALSE(s.exists("extra"));
+    }
+}
+
+TEST_CASE("Group entries") {
+    using ST = simpleConfig::ValType;
+    using KO = simpleConfig::Setting::KeyOrder;
+
+    simpleConfig::Setting s{ST::GROUP};
+    s.add_child("c", 1);
+    s.add_child("a", 2);
+    s.add_child("b", 3);
+
+    auto range = s.entries();
+    CHECK(range.size() == 3);
+
+    std::string keys;
+    int total = 0;
+    for (auto [name, value] : range) {
+        keys += name;
+        total += value.get<int>();
+        value.set_value(value.get<int>() * 10);
+    }
+    CHECK(keys == "abc"s);
+    CHECK(total == 6);
+    CHECK(s.at("a").get<int>() == 20);
+
+    keys.clear();
+    for (const auto &[name, value] : s.entries(KO::INSERTION)) {
+        keys += name;
+    }
+    CHECK(keys == "cab"s);
+
+    auto iter = s.entries().begin();
+    CHECK((*iter).first == "a");
+    ++iter;
+    CHECK((*iter).second.get<int>() == 30);
+
+    simpleConfig::Setting l{ST::LIST};
+    CHECK_THROWS(l.entries());
+}
@@ -2,6 +2,13 @@
 #include <doctest.h>
 
 #include <simpleConfig.hpp>
+#include <skip_scan.hpp>
+#include <parser_base.hpp>
+#include <line_index.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 
 #include <string>
 
@@ -497,3 +504,616 @@ a : "a\x20b"
 
 
 }
+
+TEST_CASE("Comment line numbers") {
+    SUBCASE("error after comments") {
+        simpleConfig::Config cfg;
+
+        std::string input = "a : 1 # one\n"
+            "// two\n"
+            "/* three\n\f\nfour\f */ b : 2\n"
+            "#\n"
+            "c : $\n"s;
+
+        CHECK_FALSE(cfg.parse(input));
+        REQUIRE(cfg.get_errors().count() > 0);
+        CHECK(cfg.get_errors().errors.front().loc.line == 7);
+    }
+
+    SUBCASE("unterminated block comment") {
+        simpleConfig::Config cfg;
+
+        std::string input = "a : 1\n\n  /* never closed\n\n"s;
+
+        CHECK_FALSE(cfg.parse(input));
+        REQUIRE(cfg.get_errors().count() > 0);
+        CHECK(cfg.get_errors().errors.front().message == "Unterminated comment starting here");
+        CHECK(cfg.get_errors().errors.front().loc.line == 2);
+    }
+}
+
+TEST_CASE("skip kernels agree") {
+    using namespace simpleConfig;
+
+    // Long enough to exercise the vector loops and the scalar tails.
+    std::string text;
+    for (int i = 0; i < 40; ++i) {
+        text += std::string(i % 7, ' ') + "\t\r\v";
+        text += (i % 3 == 0) ? "\f\n" : (i % 3 == 1) ? "\n" : "\f";
+    }
+    std::string block = text + "x*y" + text + "*/";
+    std::string line = std::string(70, 'c') + "\f\n";
+
+    auto original = skip_scan::active_kernel();
+
+    for (auto k : { skip_scan::Kernel::SCALAR, skip_scan::Kernel::SSE2,
+            skip_scan::Kernel::AVX2 }) {
+        if (not skip_scan::use_kernel(k)) continue;
+
+        for (size_t start = 0; start < 40; ++start) {
+            int scalar_lines = 0, lines = 0;
+
+            skip_scan::use_kernel(skip_scan::Kernel::SCALAR);
+            auto scalar_len = skip_scan::blanks(text.data() + start,
+                    text.size() - start, scalar_lines);
+            skip_scan::use_kernel(k);
+            auto len = skip_scan::blanks(text.data() + start,
+                    text.size() - start, lines);
+
+            CHECK(len == scalar_len);
+            CHECK(lines == scalar_lines);
+        }
+
+        int lines = 0;
+        CHECK(skip_scan::blanks(text.data(), text.size(), lines) == text.size());
+        CHECK(lines == 40);
+
+        lines = 0;
+        CHECK(skip_scan::block_stop(block.data(), block.size(), lines) == text.size() + 1);
+        CHECK(lines == 40);
+
+        CHECK(skip_scan::line_end(line.data(), line.size()) == 70);
+    }
+
+    skip_scan::use_kernel(original);
+}
+
+TEST_CASE("zero copy strings") {
+    simpleConfig::Config cfg;
+    cfg.set_zero_copy(true);
+
+    std::string input = R"DELIM(
+plain : "hello",
+escaped : "a\tb",
+joined : "hel" "lo",
+arr : [ "x", "y\n" ],
+nested : { s : "deep" }
+)DELIM"s;
+
+    REQUIRE(cfg.parse(input));
+
+    // The Config has its own copy of the text.
+    input.assign(input.size(), '#');
+
+    CHECK(cfg.at("plain").is_borrowed());
+    CHECK(cfg.at("plain").get<std::string_view>() == "hello"sv);
+    CHECK(cfg.at("plain").get<std::string>() == "hello"s);
+
+    CHECK_FALSE(cfg.at("escaped").is_borrowed());
+    CHECK(cfg.at("escaped").get<std::string_view>() == "a\tb"sv);
+
+    CHECK_FALSE(cfg.at("joined").is_borrowed());
+    CHECK(cfg.at("joined").get<std::string>() == "hello"s);
+
+    CHECK(cfg.at_path("arr.[0]").is_borrowed());
+    CHECK_FALSE(cfg.at_path("arr.[1]").is_borrowed());
+    CHECK(cfg.at_path("arr.[1]").get<std::string_view>() == "y\n"sv);
+
+    CHECK(cfg.at_path("nested.s").get<std::string_view>() == "deep"sv);
+    CHECK_THROWS(cfg.at_path("nested").get<std::string_view>());
+
+    // Copies hold their own text, so they outlive the next parse.
+    simpleConfig::Setting copy = cfg.at("plain");
+    simpleConfig::Setting group_copy = cfg.at("nested");
+    CHECK_FALSE(copy.is_borrowed());
+    CHECK_FALSE(group_copy.at("s").is_borrowed());
+    REQUIRE(cfg.parse(R"DELIM(plain : "something else entirely, and longer")DELIM"s));
+    CHECK(copy.get<std::string>() == "hello"s);
+    CHECK(group_copy.at("s").get<std::string>() == "deep"s);
+
+    // Without the mode, everything is copied.
+    simpleConfig::Config copying;
+    REQUIRE(copying.parse(R"DELIM(plain : "hello")DELIM"s));
+    CHECK_FALSE(copying.at("plain").is_borrowed());
+    CHECK(copying.at("plain").get<std::string_view>() == "hello"sv);
+}
+
+TEST_CASE("parse_file") {
+    auto file_name = "t02-parse-file.cfg"s;
+    {
+        std::ofstream out{file_name, std::ios_base::binary};
+        out << "a : 1\nb : \"two\"\n";
+    }
+
+    SUBCASE("mapped") {
+        simpleConfig::Config cfg;
+        REQUIRE(cfg.parse_file(file_name));
+        CHECK(cfg.at("a").get<int>() == 1);
+        CHECK(cfg.at("b").get<std::string>() == "two"s);
+        CHECK(cfg.last_input().bytes == 16);
+#if defined(__unix__)
+        CHECK(cfg.last_input().mapped);
+#endif
+    }
+
+    SUBCASE("mapped zero copy") {
+        simpleConfig::Config cfg;
+        cfg.set_zero_copy(true);
+        REQUIRE(cfg.parse_file(file_name));
+        CHECK(cfg.at("b").is_borrowed());
+        CHECK(cfg.at("b").get<std::string_view>() == "two"sv);
+    }
+
+    SUBCASE("missing file") {
+        simpleConfig::Config cfg;
+        CHECK_FALSE(cfg.parse_file("does-not-exist.cfg"s));
+        CHECK(cfg.has_errors());
+        CHECK(cfg.last_input().bytes == 0);
+    }
+
+    std::remove(file_name.c_str());
+}
+
+TEST_CASE("scalar lexer matches the cascade") {
+    using namespace simpleConfig;
+
+    std::vector<std::string> tokens = {
+        "true", "FALSE", "TrUe,", "tru", "falsey", "t",
+        "0", "42", "-17", "+5", "007", "1_000", "+-5", "- 5",
+        "0x1F", "0X1f ", "0x", "0xZZ", "0x1G", "-0x10",
+        "1.5", "-.5", "1.", "1.e3", "2.5e-3", "1e5", "1e", "1.5e+", "1.5.",
+        "+inf", "-nan", "99999999999999999999", "1e999", "12abc",
+        "\"str\"", "\"a\" \"b\"", "\"esc\\n\"", "\"open", "bare", "{", ""
+    };
+
+    for (auto const &t : tokens) {
+        CAPTURE(t);
+
+        error_list el1, el2;
+        ParserBase cascade{t, "Test"s, el1};
+        ParserBase single{t, "Test"s, el2};
+
+        ParserBase::scalar_token tok;
+        std::string buf;
+        bool got = single.lex_scalar(tok, buf);
+
+        if (auto bv = cascade.match_bool_value()) {
+            REQUIRE(got);
+            CHECK(tok.type == ValType::BOOL);
+            CHECK(tok.bool_value == *bv);
+        } else if (auto lv = cascade.match_integer_value()) {
+            REQUIRE(got);
+            CHECK(tok.type == ValType::INTEGER);
+            CHECK(tok.int_value == *lv);
+        } else if (auto dv = cascade.match_double_value()) {
+            REQUIRE(got);
+            CHECK(tok.type == ValType::FLOAT);
+            if (*dv == *dv) {
+                CHECK(tok.float_value == *dv);
+            }
+        } else if (auto sv = cascade.match_string_value()) {
+            REQUIRE(got);
+            CHECK(tok.type == ValType::STRING);
+            CHECK(tok.string_value == *sv);
+        } else {
+            CHECK_FALSE(got);
+        }
+
+        CHECK(single.current_loc.offset == cascade.current_loc.offset);
+        CHECK(el1.count() == el2.count());
+    }
+}
+
+namespace {
+    // Writes each event it sees into a string.
+    struct EventRecorder : public simpleConfig::ParseHandler {
+        std::stringstream out;
+        std::string skip_key;
+        std::string stop_key;
+
+        Action key(std::string_view name) override {
+            out << name << "=";
+            if (name == skip_key) return Action::SKIP;
+            if (name == stop_key) return Action::STOP;
+            return Action::CONTINUE;
+        }
+        Action begin_group() override { out << "{ "; return Action::CONTINUE; }
+        Action end_group() override { out << "} "; return Action::CONTINUE; }
+        Action begin_array() override { out << "[ "; return Action::CONTINUE; }
+        Action end_array() override { out << "] "; return Action::CONTINUE; }
+        Action begin_list() override { out << "( "; return Action::CONTINUE; }
+        Action end_list() override { out << ") "; return Action::CONTINUE; }
+        Action bool_value(bool v) override {
+            out << (v ? "T " : "F "); return Action::CONTINUE; }
+        Action integer_value(long v) override {
+            out << "i" << v << " "; return Action::CONTINUE; }
+        Action float_value(double v) override {
+            out << "f" << v << " "; return Action::CONTINUE; }
+        Action string_value(std::string_view v, bool in_source) override {
+            out << (in_source ? "s" : "S") << v << " "; return Action::CONTINUE; }
+    };
+}
+
+TEST_CASE("event parsing") {
+    std::string input = R"DELIM(
+a : 1,
+b : { c : true, d : "x" "y" },
+e : [ 1.5, 2 ],
+f : ( "q", { g : [ { h : 1 } ] } )
+)DELIM"s;
+
+    SUBCASE("all events") {
+        simpleConfig::Config cfg;
+        EventRecorder rec;
+
+        CHECK(cfg.scan(input, rec));
+        CHECK(rec.out.str() == "a=i1 b={ c=T d=Sxy } e=[ f1.5 f2 ] "
+            "f=( sq { g=[ { h=i1 } ] } ) "s);
+    }
+
+    SUBCASE("skip a subtree") {
+        simpleConfig::Config cfg;
+        EventRecorder rec;
+        rec.skip_key = "b";
+
+        CHECK(cfg.scan(input, rec));
+        CHECK(rec.out.str() == "a=i1 b=e=[ f1.5 f2 ] "
+            "f=( sq { g=[ { h=i1 } ] } ) "s);
+    }
+
+    SUBCASE("stop early") {
+        simpleConfig::Config cfg;
+        EventRecorder rec;
+        rec.stop_key = "c";
+
+        CHECK(cfg.scan(input, rec));
+        CHECK(rec.out.str() == "a=i1 b={ c="s);
+        CHECK_FALSE(cfg.has_errors());
+    }
+
+    SUBCASE("stop inside a group in an array") {
+        simpleConfig::Config cfg;
+        EventRecorder rec;
+        rec.stop_key = "i";
+
+        CHECK(cfg.scan("x : [ { h : 1, i : 2 } ]"sv, rec));
+        CHECK(rec.out.str() == "x=[ { h=i1 i="s);
+        CHECK_FALSE(cfg.has_errors());
+    }
+
+    SUBCASE("syntax errors in skipped subtrees still count") {
+        simpleConfig::Config cfg;
+        EventRecorder rec;
+        rec.skip_key = "b";
+
+        CHECK_FALSE(cfg.scan("a : 1, b : { c : [ 1, true ] }"sv, rec));
+        CHECK(cfg.has_errors());
+    }
+}
+
+TEST_CASE("arena parsing") {
+    std::string input = R"DELIM(
+name : "a string long enough to need its own allocation",
+b : { c : true, d : [ 1, 2, 3 ] },
+f : ( "q", { g : 1.5 } )
+)DELIM"s;
+
+    simpleConfig::Config cfg;
+    cfg.set_arena(true);
+    CHECK(cfg.arena());
+
+    SUBCASE("values") {
+        CHECK(cfg.parse(input));
+        CHECK(cfg.at("name").get<std::string>() ==
+                "a string long enough to need its own allocation"s);
+        CHECK(cfg.at_path("b.d.[2]").get<int>() == 3);
+        CHECK(cfg.at_path("f.[1].g").get<double>() == 1.5);
+    }
+
+    SUBCASE("reparse") {
+        CHECK(cfg.parse(input));
+        CHECK(cfg.parse("x : 1"s));
+        CHECK(cfg.at("x").get<int>() == 1);
+        CHECK_FALSE(cfg.get_settings().exists("name"));
+
+        cfg.set_arena(false);
+        CHECK(cfg.parse(input));
+        CHECK(cfg.at_path("b.c").get<bool>());
+    }
+
+    SUBCASE("with zero copy") {
+        cfg.set_zero_copy(true);
+        CHECK(cfg.parse(input));
+        CHECK(cfg.at("name").is_borrowed());
+    }
+}
+
+TEST_CASE("compiled paths") {
+    simpleConfig::Config cfg;
+
+    std::string input = R"DELIM( a : { b = 3, s = "hi" }, c = "hello"
+    d : [ 3 4 5 ], e : ( { f = 1.5 }, 7 ) )DELIM"s;
+
+    REQUIRE(cfg.parse(input));
+
+    simpleConfig::CompiledPath ab{"a.b"};
+    simpleConfig::CompiledPath d2{"d.[2]"};
+    simpleConfig::CompiledPath dlast{"d.[-1]"};
+    simpleConfig::CompiledPath ef{"e.[0].f"};
+    simpleConfig::CompiledPath missing{"a.x"};
+
+    CHECK(ab.size() == 2);
+
+    SUBCASE("matches at_path") {
+        for (auto p : {"a.b", "a.s", "c", "d.[0]", "d.[-1]", "e.[0].f", "e.[1]"}) {
+            simpleConfig::CompiledPath cp{p};
+            CHECK(&cfg.at(cp) == &cfg.at_path(p));
+        }
+    }
+
+    SUBCASE("typed access") {
+        CHECK(cfg.get<int>(ab) == 3);
+        CHECK(cfg.get<int>(d2) == 5);
+        CHECK(cfg.get<int>(dlast) == 5);
+        CHECK(cfg.get<double>(ef) == 1.5);
+        CHECK(ab.get<long>(cfg.get_settings()) == 3);
+        CHECK(cfg.get<std::string>(simpleConfig::CompiledPath{"a.s"}) == "hi"s);
+    }
+
+    SUBCASE("missing") {
+        CHECK(cfg.lkup(missing) == nullptr);
+        CHECK_THROWS(cfg.at(missing));
+        CHECK(cfg.get<int>(missing, 42) == 42);
+        CHECK(cfg.lkup(simpleConfig::CompiledPath{"d.[3]"}) == nullptr);
+        CHECK(cfg.lkup(simpleConfig::CompiledPath{"c.x"}) == nullptr);
+    }
+
+    SUBCASE("from a vector") {
+        simpleConfig::CompiledPath v{std::vector{"d"s, "1"s}};
+        CHECK(cfg.get<int>(v) == 4);
+        CHECK_THROWS(simpleConfig::CompiledPath{std::vector{"d"s, "1x"s}});
+    }
+
+    SUBCASE("malformed") {
+        CHECK_THROWS(simpleConfig::CompiledPath{""});
+        CHECK_THROWS(simpleConfig::CompiledPath{"a..b"});
+        CHECK_THROWS(simpleConfig::CompiledPath{"a.[x]"});
+        CHECK_THROWS(simpleConfig::CompiledPath{"a.[1"});
+    }
+}
+
+TEST_CASE("lazy parsing") {
+    std::string input = R"DELIM(
+top : 1,
+a : {
+    s : "a } in a string, and an escaped \" quote",
+    b : { c : [ 1, 2, 3 ], d : ( "x", { e : true } ) }
+    # a ] in a comment
+    /* and { in
+       a block comment */
+    f : 2.5
+},
+g : { h : "z" }
+)DELIM"s;
+
+    simpleConfig::Config eager;
+    REQUIRE(eager.parse(input));
+    std::stringstream expected;
+    eager.get_settings().stream_setting(expected);
+
+    simpleConfig::Config cfg;
+    cfg.set_lazy(1);
+    CHECK(cfg.lazy_level() == 1);
+
+    SUBCASE("groups load when used") {
+        REQUIRE(cfg.parse(input));
+        auto &root = cfg.get_settings();
+        CHECK(root.count() == 3);
+        CHECK(root.at("a").is_deferred());
+        CHECK(root.at("g").is_deferred());
+        CHECK_FALSE(root.at("top").is_deferred());
+
+        CHECK(cfg.at_path("a.b.c.[2]").get<int>() == 3);
+        CHECK_FALSE(root.at("a").is_deferred());
+        CHECK(root.at("g").is_deferred());
+
+        std::stringstream got;
+        root.stream_setting(got);
+        CHECK(got.str() == expected.str());
+        CHECK_FALSE(root.at("g").is_deferred());
+        CHECK_FALSE(cfg.has_errors());
+    }
+
+    SUBCASE("second level") {
+        cfg.set_lazy(2);
+        REQUIRE(cfg.parse(input));
+        CHECK_FALSE(cfg.at("a").is_deferred());
+        CHECK(cfg.at_path("a.b").is_deferred());
+        CHECK(cfg.at_path("a.f").get<double>() == 2.5);
+        CHECK(cfg.at_path("a.b.d.[1].e").get<bool>());
+    }
+
+    SUBCASE("copies are loaded") {
+        REQUIRE(cfg.parse(input));
+        simpleConfig::Setting copy{cfg.at("g")};
+        CHECK_FALSE(copy.is_deferred());
+        CHECK(copy.at("h").get<std::string>() == "z"s);
+    }
+
+    SUBCASE("syntax errors show up on load") {
+        REQUIRE(cfg.parse("a : { x : 1, y }, b : 2"s));
+        CHECK_FALSE(cfg.has_errors());
+        CHECK(cfg.at("b").get<int>() == 2);
+        CHECK(cfg.at_path("a.x").get<int>() == 1);
+        CHECK(cfg.has_errors());
+    }
+
+    SUBCASE("unbalanced") {
+        CHECK_FALSE(cfg.parse("a : { x : ( 1 }"s));
+        CHECK_FALSE(cfg.parse("a : { x : 1"s));
+    }
+
+    SUBCASE("parse_file") {
+        {
+            std::ofstream strm{"t02-lazy.cfg"};
+            strm << input;
+        }
+        cfg.set_arena(true);
+        REQUIRE(cfg.parse_file("t02-lazy.cfg"));
+        CHECK(cfg.at_path("g.h").get<std::string>() == "z"s);
+        std::remove("t02-lazy.cfg");
+    }
+}
+
+TEST_CASE("parallel parsing") {
+    std::string input;
+    for (int i = 0; i < 50; ++i) {
+        auto n = std::to_string(i);
+        input += "s" + n + " : { name : \"section " + n + "\", port : " + n +
+            ", list : ( 1, { x : [ 1.5, 2.5 ] } ), inner : { s : \"}\" } }\n";
+        input += "v" + n + " = " + n + ";\n";
+    }
+
+    auto serial_text = [](const std::string &text) {
+        simpleConfig::Config cfg;
+        cfg.parse(text);
+        std::stringstream out;
+        cfg.get_settings().stream_setting(out);
+        out << cfg.get_errors();
+        return out.str();
+    };
+
+    auto parallel_text = [](const std::string &text, bool arena) {
+        simpleConfig::Config cfg;
+        cfg.set_threads(4);
+        cfg.set_arena(arena);
+        cfg.parse(text);
+        std::stringstream out;
+        cfg.get_settings().stream_setting(out);
+        out << cfg.get_errors();
+        return out.str();
+    };
+
+    SUBCASE("same tree") {
+        simpleConfig::Config cfg;
+        cfg.set_threads(4);
+        CHECK(cfg.threads() == 4);
+        REQUIRE(cfg.parse(input));
+        CHECK(cfg.get_settings().count() == 100);
+        CHECK(cfg.at_path("s49.list.[1].x.[1]").get<double>() == 2.5);
+        CHECK(cfg.at_path("s7.inner.s").get<std::string>() == "}"s);
+
+        CHECK(parallel_text(input, false) == serial_text(input));
+        CHECK(parallel_text(input, true) == serial_text(input));
+    }
+
+    SUBCASE("same errors") {
+        auto bad_group = input + "s_bad : { a : 1, a : 2 }\ns_last : { b : }\n";
+        CHECK(parallel_text(bad_group, false) == serial_text(bad_group));
+
+        auto dup_top = input + "s3 : { c : 1 }\n";
+        CHECK(parallel_text(dup_top, false) == serial_text(dup_top));
+
+        auto unclosed = input + "s_open : { d : [ 1, 2 }\n";
+        CHECK(parallel_text(unclosed, true) == serial_text(unclosed));
+
+        simpleConfig::Config cfg;
+        cfg.set_threads(4);
+        CHECK_FALSE(cfg.parse(bad_group));
+        CHECK(cfg.has_errors());
+    }
+
+    SUBCASE("zero copy") {
+        simpleConfig::Config cfg;
+        cfg.set_threads(4);
+        cfg.set_zero_copy(true);
+        REQUIRE(cfg.parse(input));
+        CHECK(cfg.at_path("s3.name").is_borrowed());
+    }
+}
+
+TEST_CASE("source offsets") {
+    using simpleConfig::LineIndex;
+
+    std::string input = "a : 1\n"
+        "grp : {\n"
+        "  b : \"two\",\n"
+        "  arr : [ 10,\n"
+        "      20 ]\n"
+        "}\n"
+        "lst : ( { c : 3 } )\f\n"
+        "last : 4.5\n";
+
+    LineIndex lines{input};
+    auto where = [&](const simpleConfig::Setting &s) {
+        auto pos = lines.position(size_t(s.source_offset()));
+        return std::to_string(pos.line) + ":" + std::to_string(pos.column);
+    };
+
+    auto check_tree = [&](simpleConfig::Config &cfg) {
+        CHECK(where(cfg.at("a")) == "0:0");
+        CHECK(where(cfg.at("grp")) == "1:0");
+        CHECK(where(cfg.at_path("grp.b")) == "2:2");
+        CHECK(where(cfg.at_path("grp.arr")) == "3:2");
+        CHECK(where(cfg.at_path("grp.arr.[0]")) == "3:10");
+        CHECK(where(cfg.at_path("grp.arr.[1]")) == "4:6");
+        CHECK(where(cfg.at_path("lst.[0]")) == "6:8");
+        CHECK(where(cfg.at_path("lst.[0].c")) == "6:10");
+        CHECK(where(cfg.at("last")) == "7:0");
+    };
+
+    SUBCASE("serial") {
+        simpleConfig::Config cfg;
+        REQUIRE(cfg.parse(input));
+        check_tree(cfg);
+    }
+
+    SUBCASE("lazy") {
+        simpleConfig::Config cfg;
+        cfg.set_lazy(1);
+        REQUIRE(cfg.parse(input));
+        check_tree(cfg);
+    }
+
+    SUBCASE("parallel") {
+        simpleConfig::Config cfg;
+        cfg.set_threads(4);
+        REQUIRE(cfg.parse(input));
+        check_tree(cfg);
+    }
+
+    SUBCASE("not parsed") {
+        simpleConfig::Config cfg;
+        REQUIRE(cfg.parse(input));
+        cfg.at("grp").add_child("new", 1);
+        CHECK(cfg.at_path("grp.new").source_offset() == -1);
+
+        simpleConfig::Setting copy{cfg.at("a")};
+        CHECK(copy.source_offset() == -1);
+
+        auto moved = std::move(cfg.at("last"));
+        CHECK(where(moved) == "7:0");
+    }
+
+    SUBCASE("line index") {
+        LineIndex none{""};
+        CHECK(none.position(0).line == 0);
+
+        LineIndex breaks{"a\nb\fc\f\nd"};
+        CHECK(breaks.position(2).line == 1);
+        CHECK(breaks.position(4).line == 2);
+        CHECK(breaks.position(7).line == 3);
+        CHECK(breaks.position(7).column == 0);
+        CHECK(breaks.position(5).column == 1);
+    }
+}
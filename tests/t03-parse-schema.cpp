@@ -401,3 +401,28 @@ TEST_CASE("enums") {
     }
 
 }
+
+TEST_CASE("slots") {
+    auto text = "c : int, a! : int, * : string, b : { _t : int, _d : 2 }, "
+        "d : { y : int, x! : int }"s;
+    auto &parser = setup_schema_parser(text);
+    INFO(parser.errors);
+
+    REQUIRE(parser.do_parse());
+
+    auto *node = parser.schema;
+    REQUIRE(node->slots.size() == 4);
+    CHECK(node->slots[0]->name == "a"s);
+    CHECK(node->slots[1]->name == "b"s);
+    CHECK(node->slots[2]->name == "c"s);
+    CHECK(node->subkeys.at("d").slot == 3);
+
+    // a is required and b has a default.
+    REQUIRE(node->needed.size() == 1);
+    CHECK(node->needed[0] == 0b011);
+
+    auto &d = node->subkeys.at("d");
+    CHECK(d.slots.size() == 2);
+    CHECK(d.subkeys.at("x").slot == 0);
+    CHECK(d.needed[0] == 0b01);
+}
@@ -2,8 +2,16 @@
 #include <doctest.h>
 
 #include <simpleConfig.hpp>
+#include <schema_parser.hpp>
+#include <config_parser.hpp>
+#include <schema_program.hpp>
+#include <parallel_validator.hpp>
 
+#include <algorithm>
 #include <string>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 using namespace std::literals::string_literals;
 
@@ -271,6 +279,95 @@ TEST_CASE("Defaults") {
         CHECK(b.get<int>() == 3);
 
     }
+
+    SUBCASE("defaults inserted into an arena tree") {
+        auto schema_text = "a : int b : { _t : string _d : \"a default long enough to allocate\"}"s;
+        auto config_text = "a = 42;"s;
+
+        auto cfg = Config();
+        cfg.set_arena(true);
+
+        CHECK(cfg.set_schema(schema_text));
+        CHECK(cfg.parse(config_text));
+
+        auto &b = cfg.get_settings().at("b");
+
+        CHECK(b.get<std::string>() == "a default long enough to allocate"s);
+        CHECK(b.get_allocator() == cfg.get_settings().get_allocator());
+    }
+}
+
+TEST_CASE("schema changed after parsing") {
+    auto validate = [](const SchemaNode &root, const std::string &config_text,
+            std::string &errors_out) {
+        error_list errors;
+        Setting tree{ValType::GROUP};
+        Parser parser{config_text, &tree, errors};
+        REQUIRE(parser.do_parse());
+        Validator validator{errors};
+        bool ok = validator.validate(&tree, &root);
+        std::stringstream out;
+        out << errors;
+        errors_out = out.str();
+        return std::make_pair(ok, tree.exists("d"));
+    };
+    std::string errors;
+
+    SUBCASE("keys added") {
+        auto schema_text = "a : int, b! : int"s;
+        error_list errs;
+        SchemaNode root;
+        SchemaParser schema_parser{schema_text, &root, errs};
+        REQUIRE(schema_parser.do_parse());
+
+        // z is slot 0 until the tree is indexed again, and b's slot is
+        // still 0 too.
+        root.add_subkey("z")->vtype = ValType::INTEGER;
+        root.add_subkey("c")->required = true;
+        root.subkeys.at("c").vtype = ValType::INTEGER;
+        auto *d = root.add_subkey("d");
+        d->vtype = ValType::INTEGER;
+        d->dflt = std::make_unique<Setting>(ValType::INTEGER);
+
+        auto [ok, added] = validate(root, "z : 1, b : 2"s, errors);
+        CHECK_FALSE(ok);
+        CHECK(errors == "line 0 : Validator: Required key = c is not present.\n"s);
+        CHECK(added);
+
+        root.index_slots();
+        std::string again;
+        CHECK(validate(root, "z : 1, b : 2"s, again).first == false);
+        CHECK(again == errors);
+    }
+
+    SUBCASE("key swapped") {
+        // The same number of subkeys, but z has no slot of its own.
+        auto schema_text = "a! : int, b : int"s;
+        error_list errs;
+        SchemaNode root;
+        SchemaParser schema_parser{schema_text, &root, errs};
+        REQUIRE(schema_parser.do_parse());
+
+        root.subkeys.erase("b");
+        root.add_subkey("z")->vtype = ValType::INTEGER;
+
+        auto [ok, added] = validate(root, "z : 1"s, errors);
+        CHECK_FALSE(ok);
+        CHECK_FALSE(added);
+        CHECK(errors == "line 0 : Validator: Required key = a is not present.\n"s);
+    }
+
+    SUBCASE("never indexed") {
+        SchemaNode root;
+        root.add_subkey("a")->vtype = ValType::INTEGER;
+        root.add_subkey("b")->required = true;
+        root.subkeys.at("b").vtype = ValType::INTEGER;
+
+        auto [ok, added] = validate(root, "a : 1"s, errors);
+        CHECK_FALSE(ok);
+        CHECK_FALSE(added);
+        CHECK(errors == "line 0 : Validator: Required key = b is not present.\n"s);
+    }
 }
 
 TEST_CASE("faults seen") {
@@ -366,4 +463,740 @@ TEST_CASE("enums on scalars") {
         CHECK(cfg.parse(config_text));       
 
     }
-}
\ No newline at end of file
+    SUBCASE("large enums on array elements") {
+        // Past EnumSet::small_limit the strings are hashed.
+        std::string strings;
+        std::string ints;
+        for (int i = 0; i < 300; ++i) {
+            strings += "\"member_" + std::to_string(i) + "\", ";
+            ints += std::to_string(i * 3) + ", ";
+        }
+        auto schema_text = "s : { _t : array _at : string _enum : [" + strings + "] }\n"
+            "i : { _t : array _at : int _enum : [" + ints + "] }"s;
+        auto cfg = Config();
+        INFO(cfg.get_errors());
+        REQUIRE(cfg.set_schema(schema_text));
+
+        auto errors = [&]() {
+            std::stringstream out;
+            cfg.stream_errors(out);
+            return out.str();
+        };
+
+        CHECK(cfg.parse("s : [\"member_0\", \"member_299\", \"member_150\"] i : [0, 897, 450]"s));
+
+        CHECK_FALSE(cfg.parse("s : [\"member_0\", \"member_300\"]"s));
+        CHECK(errors().find("String value is not in enum list") != std::string::npos);
+
+        CHECK_FALSE(cfg.parse("i : [3, 4]"s));
+        CHECK(errors().find("Int value is not in enum list") != std::string::npos);
+
+        CHECK_FALSE(cfg.parse("s : [\"member\"]"s));
+        CHECK_FALSE(cfg.parse("s : [\"\"]"s));
+    }
+}
+TEST_CASE("lazy parsing with a schema") {
+    auto schema_text = "a : int b : { c! : int d : { _t : int _d : 7 } } e : { f : string }"s;
+    auto good_text = "a = 1; b = { c = 2 }; e = { f = \"x\" }"s;
+    auto bad_text = "a = 1; b = { d = 3 }; e = { f = \"x\" }"s;
+
+    auto cfg = Config();
+    CHECK(cfg.set_schema(schema_text));
+
+    SUBCASE("eager") {
+        cfg.set_lazy(1);
+        CHECK(cfg.parse(good_text));
+        CHECK_FALSE(cfg.at("b").is_deferred());
+        CHECK(cfg.at_path("b.d").get<int>() == 7);
+
+        CHECK_FALSE(cfg.parse(bad_text));
+    }
+
+    SUBCASE("on touch") {
+        cfg.set_lazy(1, Config::LazyCheck::ON_TOUCH);
+        CHECK(cfg.parse(good_text));
+        CHECK(cfg.at("b").is_deferred());
+        CHECK(cfg.at_path("b.d").get<int>() == 7);
+        CHECK_FALSE(cfg.has_errors());
+
+        CHECK(cfg.parse(bad_text));
+        CHECK(cfg.at("e").at("f").get<std::string>() == "x"s);
+        CHECK_FALSE(cfg.has_errors());
+        CHECK(cfg.at("b").count() == 1);
+        CHECK(cfg.has_errors());
+    }
+}
+
+namespace {
+
+    // Validate with both the Validator and a compiled SchemaProgram. The
+    // errors, the result and the tree (defaults and all) must be the same.
+    void check_same_as_validator(const std::string &schema_text,
+            const std::string &config_text) {
+
+        error_list schema_errors;
+        SchemaNode root;
+        SchemaParser schema_parser{schema_text, &root, schema_errors};
+        REQUIRE(schema_parser.do_parse());
+        SchemaProgram program{root};
+
+        // 0 is the Validator, 1 the ProgramValidator, and past that a
+        // ParallelValidator with that many threads that splits every array.
+        auto run = [&](int how) {
+            error_list errors;
+            Setting tree{ValType::GROUP};
+            Parser parser{config_text, &tree, errors};
+            REQUIRE(parser.do_parse());
+
+            bool ok;
+            if (how == 0) {
+                Validator validator{errors};
+                ok = validator.validate(&tree, &root);
+            } else if (how == 1) {
+                ProgramValidator validator{program, errors};
+                ok = validator.validate(&tree);
+            } else {
+                ParallelValidator validator{program, errors, unsigned(how)};
+                validator.min_split = 1;
+                ok = validator.validate(&tree);
+            }
+
+            std::stringstream out;
+            out << ok << "\n" << errors << "\n";
+            tree.stream_setting(out);
+            return out.str();
+        };
+
+        INFO(schema_text);
+        INFO(config_text);
+        auto expected = run(0);
+        CHECK(run(1) == expected);
+        CHECK(run(2) == expected);
+        CHECK(run(4) == expected);
+    }
+}
+
+TEST_CASE("compiled schema program") {
+
+    SUBCASE("keys") {
+        auto schema = "foo! : int bar : int baz : { _t : string _d : \"zz\"}"s;
+        check_same_as_validator(schema, "foo : 1, bar : 2"s);
+        check_same_as_validator(schema, "bar : 2, other : 3"s);
+        check_same_as_validator(schema, "foo : true, bar : \"x\", baz : 1"s);
+        check_same_as_validator(schema, "foo : { a : 1 }, bar : [ 1 ]"s);
+    }
+
+    SUBCASE("star") {
+        check_same_as_validator("foo : int, *:int"s, "bar : 32"s);
+        check_same_as_validator("foo : int, *:int"s, "bar : true"s);
+        check_same_as_validator("foo : int, *!:int"s, "foo : 1"s);
+        check_same_as_validator("foo : int bar :{ alpha : int * : any}"s,
+                "foo : 32, bar : { x : 74, y : { z : 1 } }"s);
+    }
+
+    SUBCASE("ranges and enums") {
+        auto ints = "a : { _t : int _range : [-5, 5]} b : { _t : int _enum:[2, 8, 16]}"s;
+        check_same_as_validator(ints, "a : 5, b : 8"s);
+        check_same_as_validator(ints, "a : 6, b : 9"s);
+        check_same_as_validator(ints, "a : 1.5, b : \"x\""s);
+
+        auto floats = "a : { _t : float _range : [-5.0, 5.12]} b : { _t : float _enum:[2.0, 8.16, 16.0]}"s;
+        check_same_as_validator(floats, "a : 5.12, b : 16.0"s);
+        check_same_as_validator(floats, "a : 5.13, b : 8.17"s);
+
+        auto strings = "a : { _t : string _enum:[\"a\", \"b\", \"yellow\"]}"s;
+        check_same_as_validator(strings, "a : \"yellow\""s);
+        check_same_as_validator(strings, "a : \"green\""s);
+
+        std::string many;
+        for (int i = 0; i < 40; ++i) {
+            many += "\"v" + std::to_string(i) + "\", ";
+        }
+        auto large = "a : { _t : array _at : string _enum:[" + many + "]}"s;
+        check_same_as_validator(large, "a : [\"v0\", \"v39\", \"v17\"]"s);
+        check_same_as_validator(large, "a : [\"v0\", \"v40\", \"v1\"]"s);
+
+    }
+
+    SUBCASE("arrays") {
+        auto schema = "a : { _t : array _at : int, _len : [2, 3], _range : [0, 9]}"s;
+        check_same_as_validator(schema, "a : [1, 2]"s);
+        check_same_as_validator(schema, "a : [1]"s);
+        check_same_as_validator(schema, "a : [1, 20, 30]"s);
+        check_same_as_validator(schema, "a : [1.5, 2.5]"s);
+        check_same_as_validator(schema, "a : 1"s);
+
+        auto groups = "b : { _t : array _at : group  a! : string c : { _t : float _d : 1.5 } }"s;
+        check_same_as_validator(groups, "b : [ { a : \"x\" }, { a : \"y\", c : 2.5 } ]"s);
+        check_same_as_validator(groups, "b : [ { c : 1.0 }, { a : 1 }, { a : \"z\" } ]"s);
+        check_same_as_validator(groups, "q : 1, b : [ { a : \"x\" }, { a : \"y\" } ]"s);
+    }
+
+    SUBCASE("split across threads") {
+        auto schema = "a : int\n"
+            "routes : { _t : array _at : group  dest! : string  metric : { _t : int _d : 1 }\n"
+            "           hops : { _t : array _at : group  via! : string  cost : { _t : int _d : 9 } } }\n"
+            "site : { name : string  more : { deep : { _t : int _d : 3 } } }\n"
+            "z : { zz : { _t : string _d : \"q\" } }"s;
+
+        auto routes = [](int n, int bad) {
+            std::string out = "routes : [ ";
+            for (int i = 0; i < n; ++i) {
+                if (i == bad) {
+                    out += "{ metric : 2 }, ";
+                } else {
+                    out += "{ dest : \"d" + std::to_string(i) + "\", hops : [ { via : \"v\" }, { via : \"w\", cost : 1 } ] }, ";
+                }
+            }
+            return out + "]\n";
+        };
+
+        check_same_as_validator(schema, routes(20, -1));
+        check_same_as_validator(schema, routes(20, 0));
+        check_same_as_validator(schema, routes(20, 7));
+        check_same_as_validator(schema, routes(20, 19));
+        // Errors before the array change how far the serial check goes.
+        check_same_as_validator(schema, "a : \"x\"\n" + routes(20, -1));
+        check_same_as_validator(schema, "a : \"x\"\n" + routes(20, 5));
+        check_same_as_validator(schema, "site : { name : 1, more : { } }\n" + routes(20, -1) + "z : { }");
+        check_same_as_validator(schema, "site : { more : { deep : 1.5 } }\nz : { zz : \"x\" }");
+        check_same_as_validator(schema, routes(20, 3) + "z : { x : 1 }");
+
+        // Defaults added above the units move the unit groups.
+        auto top = "b : { _t : int _d : 5 } g : { x : { _t : int _d : 1 } }"s;
+        check_same_as_validator(top, "g = { };"s);
+        check_same_as_validator(top, "g = { }; b = 2;"s);
+        check_same_as_validator(schema + "\ntop : { _t : int _d : 5 }",
+            "site : { }\n" + routes(20, -1) + "z : { }");
+
+        Config cfg;
+        cfg.set_threads(2);
+        REQUIRE(cfg.set_schema(top));
+        REQUIRE(cfg.parse("g = { };"));
+        CHECK(cfg.at("b").get<int>() == 5);
+        CHECK(cfg.at("g").at("x").get<int>() == 1);
+    }
+
+    SUBCASE("Config with threads") {
+        auto schema = "* : { _t : array _at : group  dest! : string  metric : { _t : int _d : 1 } }"s;
+        std::string config;
+        for (int t = 0; t < 4; ++t) {
+            config += "table" + std::to_string(t) + " : [ ";
+            for (int i = 0; i < 300; ++i) {
+                config += (t == 2 and i == 150) ? "{ }, "s : "{ dest : \"d\" }, "s;
+            }
+            config += "]\n";
+        }
+
+        for (auto good : {true, false}) {
+            auto text = good ? config : config + "extra : 1\n";
+            Config serial;
+            Config threaded;
+            threaded.set_threads(4);
+            threaded.set_arena(true);
+            REQUIRE(serial.set_schema(schema));
+            REQUIRE(threaded.set_schema(schema));
+
+            CHECK(serial.parse(text) == threaded.parse(text));
+            std::stringstream a, b;
+            serial.stream_errors(a);
+            serial.get_settings().stream_setting(a);
+            threaded.stream_errors(b);
+            threaded.get_settings().stream_setting(b);
+            CHECK(a.str() == b.str());
+        }
+    }
+
+    SUBCASE("wide groups") {
+        std::string schema;
+        std::string config;
+        for (int i = 0; i < 150; ++i) {
+            auto n = std::to_string(i);
+            if (i % 7 == 0) {
+                schema += "k" + n + "! : int\n";
+            } else if (i % 5 == 0) {
+                schema += "k" + n + " : { _t : int _d : " + n + " }\n";
+            } else {
+                schema += "k" + n + " : int\n";
+            }
+            if (i % 3 != 0) {
+                config += "k" + n + " : " + n + "\n";
+            }
+        }
+        check_same_as_validator(schema, config);
+        check_same_as_validator(schema, config + "extra : 1\n"s);
+        check_same_as_validator("g : { " + schema + " }", "g : { " + config + " }");
+
+        // More slots than fit in the bitset kept on the stack.
+        std::string wider;
+        std::string some;
+        for (int i = 0; i < 300; ++i) {
+            auto n = std::to_string(i);
+            wider += (i % 11 == 0 ? "w" + n + "! : int\n" : "w" + n + " : { _t : int _d : 1 }\n");
+            if (i % 4 == 0) {
+                some += "w" + n + " : " + n + "\n";
+            }
+        }
+        check_same_as_validator(wider, some);
+        check_same_as_validator("a : { _t : array _at : group " + wider + " }",
+            "a : [ { " + some + " }, { w1 : 5 } ]");
+    }
+}
+
+TEST_CASE("single pass validation") {
+
+    auto errors_of = [](Config &cfg) {
+        std::stringstream out;
+        cfg.stream_errors(out);
+        return out.str();
+    };
+
+    // Either both pass and give the same settings, or both fail and the
+    // one error of the single pass is among the errors of the other.
+    auto check_same = [&](const std::string &schema_text, const std::string &config_text) {
+        Config regular;
+        Config fused;
+        fused.set_single_pass(true);
+        REQUIRE(regular.set_schema(schema_text));
+        REQUIRE(fused.set_schema(schema_text));
+
+        INFO(schema_text);
+        INFO(config_text);
+        bool ok = regular.parse(config_text);
+        INFO(errors_of(regular));
+        INFO(errors_of(fused));
+        REQUIRE(fused.parse(config_text) == ok);
+
+        if (ok) {
+            std::stringstream a, b;
+            regular.get_settings().stream_setting(a);
+            fused.get_settings().stream_setting(b);
+            CHECK(a.str() == b.str());
+        } else {
+            auto err = errors_of(fused);
+            auto msg = err.substr(err.find(": ") + 2);
+            msg = msg.substr(0, msg.find('\n'));
+            CHECK(fused.get_errors().count() == 1);
+            CHECK(errors_of(regular).find(msg) != std::string::npos);
+        }
+    };
+
+    auto schema = "name! : string\n"
+        "port : { _t : int _range : [1, 65535] _d : 80 }\n"
+        "mode : { _t : string _enum : [\"a\", \"b\"] }\n"
+        "ratio : { _t : float _range : [0.0, 1.0] }\n"
+        "tags : { _t : array _at : string _len : [1, 3] }\n"
+        "hosts : { _t : array _at : group  host! : string  weight : { _t : float _d : 1.5 } }\n"
+        "extra : { * : int }\n"
+        "anything : any\n"s;
+
+    check_same(schema, "name : \"x\""s);
+    check_same(schema, "name : \"x\", port : 8080, mode : \"b\", ratio : 0.5, tags : [\"t\"]"s);
+    check_same(schema, "name : \"x\", hosts : [ { host : \"a\" }, { host : \"b\", weight : 2.0 } ]"s);
+    check_same(schema, "name : \"x\", extra : { a : 1, b : 2 }, anything : ( 1, \"two\", { three : 3 } )"s);
+    check_same(schema, "name : \"x\", anything : 42"s);
+
+    check_same(schema, "port : 80"s);
+    check_same(schema, "name : \"x\", bogus : 1"s);
+    check_same(schema, "name : 1"s);
+    check_same(schema, "name : \"x\", port : 0"s);
+    check_same(schema, "name : \"x\", mode : \"c\""s);
+    check_same(schema, "name : \"x\", ratio : 1.5"s);
+    check_same(schema, "name : \"x\", tags : [1, 2]"s);
+    check_same(schema, "name : \"x\", tags : []"s);
+    check_same(schema, "name : \"x\", tags : [\"a\", \"b\", \"c\", \"d\"]"s);
+    check_same(schema, "name : \"x\", hosts : [ { weight : 2.0 } ]"s);
+    check_same(schema, "name : \"x\", hosts : [ { host : \"a\", port : 1 } ]"s);
+    check_same(schema, "name : \"x\", extra : { a : 1.5 }"s);
+    check_same(schema, "name : \"x\", extra : 3"s);
+
+    SUBCASE("stops at the first error") {
+        Config cfg;
+        cfg.set_single_pass(true);
+        REQUIRE(cfg.set_schema(schema));
+
+        // A regular parse would get to the syntax error on the third line.
+        CHECK_FALSE(cfg.parse("name : \"x\"\nbogus : 1\nport : { ]\n"s));
+        CHECK(cfg.get_errors().count() == 1);
+        CHECK(errors_of(cfg) == "line 1 : Validator: Key = bogus is not allowed.\n");
+    }
+
+    SUBCASE("star required") {
+        check_same("a : int, *! : string"s, "a : 1"s);
+        check_same("a : int, *! : string"s, "a : 1, b : \"x\""s);
+    }
+}
+
+TEST_CASE("shared schema") {
+    auto schema_text = "name! : string port : { _t : int _range : [1, 65535] _d : 80 }"
+        " tags : { _t : array _at : string _enum : [\"a\", \"b\"] }"s;
+
+    SUBCASE("bad schema") {
+        error_list errors;
+        CHECK(Schema::parse("foo : nosuchtype"s, errors) == nullptr);
+        CHECK_FALSE(errors.empty());
+    }
+
+    SUBCASE("several configs") {
+        error_list errors;
+        auto schema = Schema::parse(schema_text, errors);
+        REQUIRE(schema);
+
+        Config a;
+        Config b;
+        a.set_schema(schema);
+        b.set_schema(schema);
+        CHECK(a.schema() == schema);
+
+        // The configs keep it alive.
+        schema.reset();
+
+        CHECK(a.parse("name : \"a\""s));
+        CHECK(a.at("port").get<int>() == 80);
+        CHECK_FALSE(b.parse("name : \"b\", port : 0"s));
+
+        b.set_schema(nullptr);
+        CHECK(b.parse("anything : 1"s));
+    }
+
+    SUBCASE("the same as set_schema(text)") {
+        error_list errors;
+        auto schema = Schema::parse(schema_text, errors);
+        REQUIRE(schema);
+
+        for (auto text : {"name : \"x\", tags : [\"a\"]"s, "port : 3"s, "name : \"x\", tags : [\"c\"]"s}) {
+            Config shared;
+            Config own;
+            shared.set_schema(schema);
+            REQUIRE(own.set_schema(schema_text));
+
+            CHECK(shared.parse(text) == own.parse(text));
+            std::stringstream a, b;
+            shared.stream_errors(a);
+            own.stream_errors(b);
+            CHECK(a.str() == b.str());
+        }
+    }
+
+    SUBCASE("on several threads") {
+        error_list errors;
+        auto schema = Schema::parse(schema_text, errors);
+        REQUIRE(schema);
+
+        std::vector<int> results(8, -1);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 8; ++t) {
+            threads.emplace_back([&, t]() {
+                int good = 0;
+                for (int i = 0; i < 200; ++i) {
+                    Config cfg;
+                    cfg.set_schema(schema);
+                    cfg.set_single_pass(i % 2 == 1);
+                    auto port = (i + t) % 3 == 0 ? 0 : 1000 + i;
+                    if (cfg.parse("name : \"n\", port : " + std::to_string(port)
+                            + ", tags : [\"b\", \"a\"]")) {
+                        good += 1;
+                    }
+                }
+                results[t] = good;
+            });
+        }
+        for (auto &th : threads) {
+            th.join();
+        }
+
+        for (int t = 0; t < 8; ++t) {
+            int expected = 0;
+            for (int i = 0; i < 200; ++i) {
+                if ((i + t) % 3 != 0) expected += 1;
+            }
+            CHECK(results[t] == expected);
+        }
+    }
+
+    SUBCASE("lazy groups keep their schema") {
+        Config cfg;
+        REQUIRE(cfg.set_schema("a : { b : { _t : int _d : 5 } }"s));
+        cfg.set_lazy(1, Config::LazyCheck::ON_TOUCH);
+        REQUIRE(cfg.parse("a : { }"s));
+
+        // The first schema is gone from the Config before the group loads.
+        REQUIRE(cfg.set_schema("z : int"s));
+        CHECK(cfg.at("a").at("b").get<int>() == 5);
+    }
+}
+
+TEST_CASE("error lines") {
+    auto schema_text = "name! : string\n"
+        "port : { _t : int _range : [1, 65535] }\n"
+        "hosts : { _t : array _at : group host! : string weight : float }\n"
+        "tags : { _t : array _at : string _enum : [\"a\", \"b\"] }\n"
+        "* : { size! : int }\n"s;
+
+    auto config_text = "name : \"x\"\n"
+        "port : 0\n"
+        "hosts : [ { host : \"a\" },\n"
+        "    { host : \"b\", weight : \"heavy\" } ]\n"
+        "tags : [ \"a\",\n"
+        "    \"c\" ]\n"
+        "section : {\n"
+        "  colour : 3\n"
+        "}\n"s;
+
+    // Errors about a key are on its line, missing keys on the line of
+    // their group.
+    auto expected =
+        "line 3 : Validator: Key = weight has wrong type.\n"
+        "line 3 : Validator: setting and schema value type don't match\n"
+        "line 1 : Validator: int value is out of range\n"
+        "line 7 : Validator: Key = colour is not allowed.\n"
+        "line 7 : Validator: Key = colour has wrong type.\n"
+        "line 6 : Validator: Required key = size is not present.\n"
+        "line 5 : Validator: String value is not in enum list\n"s;
+
+    auto errors_of = [](Config &cfg) {
+        std::stringstream out;
+        cfg.stream_errors(out);
+        return out.str();
+    };
+
+    SUBCASE("serial") {
+        Config cfg;
+        REQUIRE(cfg.set_schema(schema_text));
+        CHECK_FALSE(cfg.parse(config_text));
+        CHECK(errors_of(cfg) == expected);
+    }
+
+    SUBCASE("threads") {
+        Config cfg;
+        cfg.set_threads(4);
+        REQUIRE(cfg.set_schema(schema_text));
+        CHECK_FALSE(cfg.parse(config_text));
+        CHECK(errors_of(cfg) == expected);
+    }
+
+    SUBCASE("checked on touch") {
+        Config cfg;
+        cfg.set_lazy(1, Config::LazyCheck::ON_TOUCH);
+        REQUIRE(cfg.set_schema(schema_text));
+        cfg.parse(config_text);
+        CHECK(errors_of(cfg) ==
+            "line 3 : Validator: Key = weight has wrong type.\n"
+            "line 3 : Validator: setting and schema value type don't match\n"
+            "line 1 : Validator: int value is out of range\n"
+            "line 5 : Validator: String value is not in enum list\n");
+
+        // The text is kept for the deferred groups, so their errors get
+        // lines too.
+        cfg.at("section").count();
+        CHECK(errors_of(cfg) ==
+            "line 3 : Validator: Key = weight has wrong type.\n"
+            "line 3 : Validator: setting and schema value type don't match\n"
+            "line 1 : Validator: int value is out of range\n"
+            "line 5 : Validator: String value is not in enum list\n"
+            "line 7 : Validator: Key = colour is not allowed.\n"
+            "line 7 : Validator: Key = colour has wrong type.\n"
+            "line 6 : Validator: Required key = size is not present.\n");
+    }
+
+    SUBCASE("Validator") {
+        error_list errors;
+        SchemaNode root;
+        SchemaParser schema_parser{schema_text, &root, errors};
+        REQUIRE(schema_parser.do_parse());
+
+        Setting tree{ValType::GROUP};
+        Parser parser{config_text, &tree, errors};
+        REQUIRE(parser.do_parse());
+
+        LineIndex lines{config_text};
+        Validator validator{errors};
+        validator.lines = &lines;
+        CHECK_FALSE(validator.validate(&tree, &root));
+
+        std::stringstream out;
+        out << errors;
+        CHECK(out.str() == expected);
+    }
+}
+
+TEST_CASE("stats") {
+    auto schema_text = "name! : string\n"
+        "port : { _t : int _d : 80 }\n"
+        "hosts : { _t : array _at : group host! : string }\n"
+        "* : { size : int }\n"s;
+
+    auto config_text = "name : \"a\\tb\"\n"
+        "hosts : [ { host : \"x\" }, { host : \"y\" } ]\n"
+        "section : { size : 3 }\n"s;
+
+    // Every way of parsing counts the same things.
+    auto check_stats = [&](Config &cfg) {
+        cfg.set_stats(true);
+        REQUIRE(cfg.set_schema(schema_text));
+        REQUIRE(cfg.parse(config_text));
+        cfg.at("section").count();
+
+        auto s = cfg.stats();
+        if constexpr (parse_stats::compiled_in) {
+            CHECK(s.config_bytes == config_text.size());
+            CHECK(s.schema_bytes == schema_text.size());
+            CHECK(s.schema_nodes > 0);
+            CHECK(s.node_count(ValType::STRING) == 3);
+            CHECK(s.node_count(ValType::GROUP) == 3);
+            CHECK(s.node_count(ValType::ARRAY) == 1);
+            CHECK(s.node_count(ValType::INTEGER) == 1);
+            CHECK(s.total_nodes() == 8);
+            CHECK(s.max_depth == 2);
+            CHECK(s.allocations > 0);
+            CHECK(s.string_bytes_copied == 5);
+            CHECK(s.escapes == 1);
+            CHECK(s.defaults_added == 1);
+            CHECK(s.parse_seconds >= 0);
+        } else {
+            CHECK(s.total_nodes() == 0);
+            CHECK(s.config_bytes == 0);
+            CHECK(s.allocations == 0);
+        }
+
+        cfg.clear_stats();
+        CHECK(cfg.stats().total_nodes() == 0);
+        CHECK(cfg.stats().allocations == 0);
+    };
+
+    SUBCASE("serial") {
+        Config cfg;
+        check_stats(cfg);
+    }
+
+    SUBCASE("threads") {
+        Config cfg;
+        cfg.set_threads(4);
+        check_stats(cfg);
+    }
+
+    SUBCASE("single pass") {
+        Config cfg;
+        cfg.set_single_pass(true);
+        check_stats(cfg);
+    }
+
+    SUBCASE("lazy") {
+        Config cfg;
+        cfg.set_lazy(1, Config::LazyCheck::ON_TOUCH);
+        check_stats(cfg);
+    }
+
+    SUBCASE("arena") {
+        Config cfg;
+        cfg.set_arena(true);
+        check_stats(cfg);
+    }
+
+    SUBCASE("off") {
+        Config cfg;
+        REQUIRE(cfg.set_schema(schema_text));
+        REQUIRE(cfg.parse(config_text));
+        CHECK(cfg.stats().total_nodes() == 0);
+        CHECK(cfg.stats().allocations == 0);
+    }
+
+    SUBCASE("json") {
+        parse_stats s;
+        s.nodes[size_t(ValType::INTEGER)] = 4;
+        s.max_depth = 2;
+        std::stringstream out;
+        s.write_json(out);
+        auto json = out.str();
+        CHECK(json.front() == '{');
+        CHECK(json.back() == '}');
+        CHECK(json.find("\"integer\":4") != std::string::npos);
+        CHECK(json.find("\"max_depth\":2") != std::string::npos);
+        CHECK(json.find("\"compiled_in\":"s + (parse_stats::compiled_in ? "true" : "false"))
+            != std::string::npos);
+    }
+}
+
+TEST_CASE("trace") {
+    auto schema_text = "* : { size : int, list : { _t : array _at : int } }\n"s;
+    auto config_text = "first : { size : 1, list : [ 1, 2, 3 ] }\n"
+        "second : { size : 2 }\n"s;
+
+    TraceRecorder rec;
+    rec.min_children = 2;
+
+    auto names_of = [&]() {
+        std::vector<std::string> names;
+        for (auto &e : rec.events()) {
+            names.push_back(e.name + (e.detail.empty() ? ""s : " "s + e.detail));
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    };
+
+    SUBCASE("serial") {
+        Config cfg;
+        cfg.set_trace(&rec);
+        REQUIRE(cfg.set_schema(schema_text));
+        REQUIRE(cfg.parse(config_text));
+
+        // Only second is too small to have a span of its check.
+        CHECK(names_of() == std::vector<std::string>{
+            "parse", "parse group first", "parse group second", "set_schema",
+            "validate", "validate array", "validate group", "validate group"});
+
+        // Every span is inside the parse or the schema.
+        auto events = rec.events();
+        auto outer = std::find_if(events.begin(), events.end(), [](auto &e) {
+            return e.name == "parse"s;
+        });
+        for (auto &e : events) {
+            if (e.name == "parse group"s) {
+                CHECK(e.start >= outer->start);
+                CHECK(e.start + e.length <= outer->start + outer->length);
+                CHECK(e.thread == outer->thread);
+            }
+        }
+    }
+
+    SUBCASE("threads") {
+        Config cfg;
+        cfg.set_threads(4);
+        cfg.set_trace(&rec);
+        REQUIRE(cfg.set_schema(schema_text));
+        REQUIRE(cfg.parse(config_text));
+        auto names = names_of();
+        CHECK(std::count(names.begin(), names.end(), "parse group first") == 1);
+        CHECK(std::count(names.begin(), names.end(), "parse group second") == 1);
+        CHECK(std::count(names.begin(), names.end(), "find groups") == 1);
+        CHECK(std::count(names.begin(), names.end(), "validate") == 1);
+    }
+
+    SUBCASE("off") {
+        Config cfg;
+        REQUIRE(cfg.set_schema(schema_text));
+        REQUIRE(cfg.parse(config_text));
+        std::stringstream out;
+        cfg.get_settings().stream_setting(out);
+        CHECK(rec.size() == 0);
+    }
+
+    SUBCASE("stream and json") {
+        Setting s{ValType::GROUP};
+        s.add_child("a", ValType::INTEGER).set_value(1L);
+        std::stringstream out;
+        s.stream_setting(out, "", &rec);
+        CHECK(names_of() == std::vector<std::string>{"stream_setting"});
+
+        std::stringstream json;
+        rec.write_json(json);
+        auto text = json.str();
+        CHECK(text.rfind("{\"traceEvents\":[", 0) == 0);
+        CHECK(text.find("\"name\":\"stream_setting\",\"cat\":\"stream\",\"ph\":\"X\"")
+            != std::string::npos);
+        CHECK(text.find("\"pid\":1,\"tid\":0") != std::string::npos);
+
+        rec.clear();
+        CHECK(rec.size() == 0);
+    }
+}
@@ -2,9 +2,11 @@
 #include <doctest.h>
 
 #include <simpleConfig.hpp>
+#include <setting_writer.hpp>
 
 #include <string>
 #include <sstream>
+#include <iomanip>
 
 TEST_CASE("Streaming") {
     SUBCASE("Toplevel group") {
@@ -121,4 +123,61 @@ subgroup : {
         CHECK(ss.str() == input);
 
     }
+
+    SUBCASE("larger than a block") {
+
+        simpleConfig::Config cfg;
+        std::string input;
+        for (int n = 0; input.size() < 3 * simpleConfig::SettingWriter::block_size; ++n) {
+            // The key is padded, as groups are written in key order.
+            auto num = std::to_string(n);
+            auto key = "group_" + std::string(6 - num.size(), '0') + num;
+            input += key + " : {\n"
+                "  a : " + num + ",\n"
+                "  b : [ 1.5, -2.25, 1e+20 ],\n"
+                "  c : [\n"
+                "    {\n"
+                "      d : \"" + num + "\"\n"
+                "    } ],\n"
+                "  e : false\n"
+                "},\n";
+        }
+        input.replace(input.size() - 2, 2, "\n");
+
+        REQUIRE(cfg.parse(input));
+        std::stringstream ss;
+        cfg.get_settings().stream_setting(ss);
+        CHECK(ss.str().size() == input.size());
+        CHECK(ss.str() == input);
+
+    }
+
+    SUBCASE("stream flags") {
+
+        // Numbers come out as the stream would write them, and bools
+        // leave it with boolalpha set.
+        simpleConfig::Config cfg;
+        REQUIRE(cfg.parse("a : 255, b : 0.125, c : true"s));
+        std::stringstream ss;
+        ss << std::hex << std::showpos << std::fixed << std::setprecision(2);
+        cfg.get_settings().stream_setting(ss, "> ");
+        ss << false;
+        CHECK(ss.str() == "> a : ff,\n> b : +0.12,\n> c : true\nfalse");
+
+    }
+
+    SUBCASE("writer") {
+
+        simpleConfig::Config cfg;
+        REQUIRE(cfg.parse("a : [ 1, 2 ], b : ( 3 )"s));
+        std::stringstream ss;
+        {
+            simpleConfig::SettingWriter writer{ss};
+            writer.write(cfg.at("a"));
+            writer.write(cfg.at("b"));
+            CHECK(ss.str().empty());
+        }
+        CHECK(ss.str() == "[ 1, 2 ]( 3 )");
+
+    }
 }
\ No newline at end of file
@@ -0,0 +1,247 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <simpleConfig.hpp>
+#include <snapshot.hpp>
+
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace std::literals::string_literals;
+
+namespace {
+    const std::string input = R"DELIM(
+name : "a string long enough that it is not kept inline",
+short : "hi",
+n : 42,
+neg : -7,
+pi : 3.141592653589793,
+tiny : 1e-300,
+flags : { on : true, off : false },
+empty : { },
+nums : [ 1, 2, 3 ],
+reals : [ 1.5, 2.5 ],
+groups : [ { a : 1 }, { a : 2, b : "x" } ],
+mixed : ( 1, "two", ( 3.0, { four : 4 } ), [ ] ),
+z : { y : { x : { w : "deep" } } }
+)DELIM"s;
+
+    std::string dump(simpleConfig::Config &cfg) {
+        std::stringstream strm;
+        cfg.get_settings().stream_setting(strm);
+        return strm.str();
+    }
+
+    std::string slurp(const std::string &file_name) {
+        std::ifstream strm{file_name, std::ios_base::binary};
+        std::stringstream buffer;
+        buffer << strm.rdbuf();
+        return buffer.str();
+    }
+
+    void spit(const std::string &file_name, const std::string &data) {
+        std::ofstream strm{file_name, std::ios_base::binary};
+        strm << data;
+    }
+}
+
+TEST_CASE("snapshot round trip") {
+    auto file_name = "t06-round-trip.snap"s;
+
+    simpleConfig::Config cfg;
+    REQUIRE(cfg.parse(input));
+    REQUIRE(cfg.save_snapshot(file_name));
+
+    simpleConfig::Config loaded;
+    REQUIRE(loaded.load_snapshot(file_name));
+    CHECK_FALSE(loaded.has_errors());
+
+    CHECK(dump(loaded) == dump(cfg));
+
+    CHECK(loaded.at("n").get<int>() == 42);
+    CHECK(loaded.at("neg").get<int>() == -7);
+    CHECK(loaded.at("pi").get<double>() == 3.141592653589793);
+    CHECK(loaded.at("tiny").get<double>() == 1e-300);
+    CHECK(loaded.at("name").is_borrowed());
+    CHECK(loaded.at_path("groups.[1].b").get<std::string>() == "x"s);
+    CHECK(loaded.at_path("mixed.[2].[1].four").get<int>() == 4);
+    CHECK(loaded.at("nums").array_type() == simpleConfig::ValType::INTEGER);
+    CHECK(loaded.at("groups").array_type() == simpleConfig::ValType::GROUP);
+    CHECK(loaded.at("empty").count() == 0);
+    CHECK(loaded.at_path("z.y.x.w").get<std::string>() == "deep"s);
+
+    // Key order is kept.
+    std::string keys;
+    for (auto [name, value] : loaded.at("groups").at(1).entries(
+                simpleConfig::Setting::KeyOrder::INSERTION)) {
+        keys += name;
+    }
+    CHECK(keys == "ab"s);
+
+    // The loaded tree can be changed like any other.
+    loaded.at("flags").add_child("maybe", true);
+    CHECK(loaded.at_path("flags.maybe").get<bool>());
+
+    // And parsing again replaces it.
+    REQUIRE(loaded.parse("q : 1"s));
+    CHECK_FALSE(loaded.get_settings().exists("name"));
+
+    std::remove(file_name.c_str());
+}
+
+TEST_CASE("snapshot checks") {
+    auto file_name = "t06-checks.snap"s;
+
+    simpleConfig::Config cfg;
+    REQUIRE(cfg.parse(input));
+    REQUIRE(cfg.save_snapshot(file_name));
+    auto image = slurp(file_name);
+
+    SUBCASE("good image in memory") {
+        simpleConfig::Setting root{simpleConfig::ValType::GROUP};
+        std::string error;
+        CHECK(simpleConfig::snapshot::read(image, root, error));
+        CHECK(root.at("n").get<int>() == 42);
+    }
+
+    SUBCASE("not a snapshot") {
+        spit(file_name, input);
+        simpleConfig::Config loaded;
+        CHECK_FALSE(loaded.load_snapshot(file_name));
+        CHECK(loaded.has_errors());
+        CHECK(loaded.get_settings().count() == 0);
+    }
+
+    SUBCASE("wrong version") {
+        auto bad = image;
+        uint32_t v = simpleConfig::snapshot::version + 1;
+        std::memcpy(bad.data() + offsetof(simpleConfig::snapshot_header, version), &v, sizeof(v));
+        spit(file_name, bad);
+
+        simpleConfig::Config loaded;
+        CHECK_FALSE(loaded.load_snapshot(file_name));
+        CHECK(loaded.get_errors().errors.front().message.find("version") != std::string::npos);
+    }
+
+    SUBCASE("damaged") {
+        auto bad = image;
+        bad[bad.size() - 3] ^= 0x40;
+        spit(file_name, bad);
+
+        simpleConfig::Config loaded;
+        CHECK_FALSE(loaded.load_snapshot(file_name));
+        CHECK(loaded.get_errors().errors.front().message.find("checksum") != std::string::npos);
+    }
+
+    SUBCASE("truncated") {
+        spit(file_name, image.substr(0, image.size() - 8));
+
+        simpleConfig::Config loaded;
+        CHECK_FALSE(loaded.load_snapshot(file_name));
+    }
+
+    SUBCASE("missing file") {
+        simpleConfig::Config loaded;
+        CHECK_FALSE(loaded.load_snapshot("t06-no-such-file.snap"s));
+    }
+
+    SUBCASE("refuses a config with errors") {
+        simpleConfig::Config bad;
+        CHECK_FALSE(bad.parse("a : [ 1, true ]"s));
+        CHECK_FALSE(bad.save_snapshot(file_name));
+    }
+
+    std::remove(file_name.c_str());
+}
+
+TEST_CASE("parse cache") {
+    auto dir = "t06-cache"s;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directory(dir);
+    auto file_name = "t06-cached.cfg"s;
+    auto schema = R"DELIM(
+name : string
+n : int
+extra : { _t : int, _d : 5 }
+)DELIM"s;
+
+    {
+        std::ofstream strm{file_name, std::ios_base::binary};
+        strm << "name : \"cached\", n : 3\n";
+    }
+
+    auto parse = [&](const std::string &schema_text) {
+        auto cfg = std::make_unique<simpleConfig::Config>();
+        cfg->set_cache_dir(dir);
+        REQUIRE(cfg->set_schema(schema_text));
+        REQUIRE(cfg->parse_file(file_name));
+        return cfg;
+    };
+
+    auto first = parse(schema);
+    CHECK_FALSE(first->last_input().cached);
+    CHECK(first->at("extra").get<int>() == 5);
+
+    // Same file, same schema : restored, defaults and all.
+    auto second = parse(schema);
+    CHECK(second->last_input().cached);
+    CHECK(second->last_input().bytes == first->last_input().bytes);
+    CHECK(second->at("name").get<std::string>() == "cached"s);
+    CHECK(second->at("extra").get<int>() == 5);
+    CHECK(dump(*second) == dump(*first));
+
+    // Strings refer into the entry, but copies don't.
+    CHECK(second->at("name").is_borrowed());
+    simpleConfig::Setting copy = second->at("name");
+    CHECK_FALSE(copy.is_borrowed());
+
+    // A different schema is a different entry.
+    auto schema2 = schema + "other : { _t : int, _d : 6 }\n"s;
+    auto third = parse(schema2);
+    CHECK_FALSE(third->last_input().cached);
+    CHECK(third->at("other").get<int>() == 6);
+
+    // So is a change to the file.
+    {
+        std::ofstream strm{file_name, std::ios_base::binary | std::ios_base::app};
+        strm << "extra : 7\n";
+    }
+    auto fourth = parse(schema);
+    CHECK_FALSE(fourth->last_input().cached);
+    CHECK(fourth->at("extra").get<int>() == 7);
+
+    // Files that don't validate are not cached.
+    {
+        std::ofstream strm{file_name, std::ios_base::binary};
+        strm << "name : 12\n";
+    }
+    for (int i = 0; i < 2; ++i) {
+        simpleConfig::Config cfg;
+        cfg.set_cache_dir(dir);
+        REQUIRE(cfg.set_schema(schema));
+        CHECK_FALSE(cfg.parse_file(file_name));
+        CHECK_FALSE(cfg.last_input().cached);
+    }
+
+    // A parse from a string is never cached, and clears the flag.
+    REQUIRE(second->parse("name : \"x\", n : 1"s));
+    CHECK_FALSE(second->last_input().cached);
+    CHECK(copy.get<std::string>() == "cached"s);
+
+    // Three good entries, nothing left half written.
+    int entries = 0;
+    for (auto &e : std::filesystem::directory_iterator(dir)) {
+        CHECK(e.path().extension() == ".snap");
+        ++entries;
+    }
+    CHECK(entries == 3);
+
+    std::filesystem::remove_all(dir);
+    std::remove(file_name.c_str());
+}